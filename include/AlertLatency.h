@@ -0,0 +1,62 @@
+#ifndef ALERT_LATENCY_H
+#define ALERT_LATENCY_H
+
+#include "Arduino.h"
+
+/**
+ * Latency of the sms alerts from the sample which crossed a critical point
+ * until the network confirmed the sms (+CMGS) for a recipient. The latencies
+ * of the last alerts are kept for percentiles, every latency above the
+ * service level objective (SLO) raises a self-diagnostic, which stays until
+ * it's reported to the server.
+ */
+
+// Number of latencies kept for the percentiles
+#define LATENCY_SAMPLES 16
+
+// Resolution of the kept latencies in ms
+#define LATENCY_UNIT 100
+
+class AlertLatency {
+public:
+
+  /**
+   * @param sloMs Highest allowed latency in ms
+   */
+  AlertLatency(unsigned long sloMs);
+
+  /**
+   * Records the confirmation of an alert for one recipient.
+   * @param  crossed   Time in ms of the sample which crossed the point
+   * @param  confirmed Time in ms the network confirmed the sms
+   * @return Returns false if the latency violated the SLO.
+   */
+  boolean record(unsigned long crossed, unsigned long confirmed);
+
+  /**
+   * Returns a percentile of the kept latencies (nearest rank).
+   * @param  percent Given percentile (0 to 100)
+   * @return Returns the latency in units of LATENCY_UNIT ms or 0 if no
+   *         latency was recorded yet.
+   */
+  uint16_t percentile(uint8_t percent) const;
+
+  /**
+   * @return Returns true if the SLO was violated since the last reset.
+   */
+  boolean violated() const { return sloViolated; }
+
+  /**
+   * Clears the self-diagnostic, e.g. after it was reported to the server.
+   */
+  void resetViolated() { sloViolated = false; }
+
+private:
+  unsigned long sloMs;
+  uint16_t samples[LATENCY_SAMPLES];
+  uint8_t count;
+  uint8_t next;
+  boolean sloViolated;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "Arduino.h"
+
+/**
+ * Calibration of the station. The distance from the sensor heads to the water
+ * surface is converted into the absolute water level above the datum of the
+ * gauge staff. The conversion consists of the mounting offset of the sensors
+ * and a piecewise-linear lookup table, both stored in the EEPROM.
+ */
+
+// Maximum number of points in the lookup table
+#define CALIBRATION_POINTS 8
+
+// EEPROM address of the calibration
+#define CALIBRATION_ADDR 0
+
+// Marker of a valid calibration in the EEPROM
+#define CALIBRATION_MAGIC 0xCA1B
+
+/**
+ * One point of the lookup table.
+ */
+struct CalibrationPoint {
+
+  // Corrected distance from the sensors to the water surface in cm
+  int16_t distance;
+
+  // Water level above datum in cm at this distance
+  int16_t level;
+};
+
+/**
+ * Calibration as it is stored in the EEPROM.
+ */
+struct Calibration {
+  uint16_t magic;
+
+  // Offset in cm added to the messured distance (mounting of the sensors)
+  int16_t mountOffset;
+
+  // Number of used points in the lookup table
+  uint8_t count;
+
+  // Lookup table sorted by ascending distance
+  CalibrationPoint points[CALIBRATION_POINTS];
+
+  // Checksum over all fields above
+  uint8_t checksum;
+};
+
+/**
+ * Loads the calibration from the EEPROM. If there's no valid calibration
+ * stored, a linear calibration with the given sensor level is stored instead.
+ * @param  sensorLevel Level of the sensor heads above datum in cm
+ * @return Returns true if a valid calibration was found in the EEPROM.
+ */
+boolean loadCalibration(int sensorLevel);
+
+/**
+ * Stores the given calibration in the EEPROM and uses it from now on.
+ * @param  calibration Given calibration
+ * @return Returns false if the lookup table is invalid.
+ */
+boolean saveCalibration(Calibration &calibration);
+
+/**
+ * Starts to enter a new calibration, the points follow one after another with
+ * addCalibrationPoint(). The new calibration is entered straight into the
+ * EEPROM, the current one stays in use until the new table is valid.
+ * @param mountOffset Offset in cm added to the messured distance
+ */
+void beginCalibration(int mountOffset);
+
+/**
+ * Appends a point to the calibration which is entered. Once the table has two
+ * points it's stored and used, every further point extends it.
+ * @param  distance Corrected distance from the sensors to the water in cm
+ * @param  level    Water level above datum in cm at this distance
+ * @return Returns false if the table is full, the distance isn't above the
+ *         one of the previous point or no calibration was begun since
+ *         the start.
+ */
+boolean addCalibrationPoint(int distance, int level);
+
+/**
+ * Converts a messured distance into the water level above datum.
+ * @param  distance Messured distance in cm
+ * @return Returns the water level above datum in cm.
+ */
+int distanceToLevel(int distance);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include "Arduino.h"
+
+/**
+ * States of a circuit breaker.
+ */
+enum BreakerState {
+
+  // Attempts are allowed, failures are counted
+  BREAKER_CLOSED,
+
+  // Attempts are refused until the backoff ran out
+  BREAKER_OPEN,
+
+  // One trial attempt decides if the breaker closes or opens again
+  BREAKER_HALF_OPEN
+};
+
+/**
+ * Circuit breaker to stop repeating an action which keeps failing, e.g. the
+ * connection to the network. After threshold failures in a row the breaker
+ * opens for a backoff, which starts at minBackoffMs and doubles with every
+ * failed trial up to maxBackoffMs. The first success closes it again.
+ */
+template<uint8_t threshold, unsigned long minBackoffMs,
+    unsigned long maxBackoffMs>
+class CircuitBreaker {
+  static_assert(threshold > 0, "breaker needs at least one failure to open");
+  static_assert(minBackoffMs <= maxBackoffMs,
+      "shortest backoff has to be below the longest one");
+
+public:
+  CircuitBreaker()
+      : current(BREAKER_CLOSED), failures(0), backoff(minBackoffMs),
+        openedAt(0) {
+  }
+
+  /**
+   * Asks if an attempt is allowed. An open breaker becomes half-open once its
+   * backoff ran out, so the next attempt is the trial.
+   * @return Returns true if the attempt is allowed.
+   */
+  boolean allow() {
+    if (current == BREAKER_OPEN && millis() - openedAt >= backoff) {
+      current = BREAKER_HALF_OPEN;
+    }
+    return current != BREAKER_OPEN;
+  }
+
+  /**
+   * Records a successful attempt, which closes the breaker.
+   */
+  void succeeded() {
+    current = BREAKER_CLOSED;
+    failures = 0;
+    backoff = minBackoffMs;
+  }
+
+  /**
+   * Records a failed attempt, which may open the breaker.
+   */
+  void failed() {
+    if (current == BREAKER_HALF_OPEN) {
+      backoff = backoff < maxBackoffMs / 2 ? backoff * 2 : maxBackoffMs;
+      open();
+    } else if (++failures >= threshold) {
+      open();
+    }
+  }
+
+  /**
+   * @return Returns the current state of the breaker.
+   */
+  BreakerState state() const { return current; }
+
+private:
+
+  /**
+   * Opens the breaker for the current backoff.
+   */
+  void open() {
+    current = BREAKER_OPEN;
+    failures = 0;
+    openedAt = millis();
+  }
+
+  BreakerState current;
+  uint8_t failures;
+  unsigned long backoff;
+  unsigned long openedAt;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef COAP_CLIENT_H
+#define COAP_CLIENT_H
+
+#include "Arduino.h"
+#include "Modem.h"
+#include "StreamWriter.h"
+
+/**
+ * Minimal CoAP client (RFC 7252) on top of the UDP socket of the modem. The
+ * payload is sent with confirmable POST requests, payloads which don't fit in
+ * one block are transferred block-wise (RFC 7959, Block1). Every block is cut
+ * out of the streamed body, so a batch is never held in RAM as a whole. A
+ * request is a protothread, so the loop keeps running while the client waits
+ * for the acknowledgements.
+ */
+
+// Default port of CoAP
+#define COAP_PORT 5683
+
+// Size exponent of the blocks (block size = 2^(SZX + 4) = 64 bytes)
+#define COAP_BLOCK_SZX 2
+
+// Size of one block in bytes
+#define COAP_BLOCK_SIZE (1 << (COAP_BLOCK_SZX + 4))
+
+// Time in ms to wait for the first acknowledgement of a message
+#define COAP_ACK_TIMEOUT 2000
+
+// Number of retransmissions of a message before giving up
+#define COAP_MAX_RETRANSMIT 4
+
+// Response code 2.31 Continue of a block which isn't the last one
+#define COAP_CONTINUE 231
+
+// Response code 5.03 Service Unavailable of an overloaded server
+#define COAP_SERVICE_UNAVAILABLE 503
+
+// Max-Age in s of a response without the option (RFC 7252, 5.10.5)
+#define COAP_MAX_AGE 60
+
+// Maximal length of the Uri-Path of a request
+#define COAP_MAX_PATH 12
+
+// Size of a message: header, token, options and one block of payload
+#define COAP_MESSAGE_SIZE (4 + 2 + 2 + COAP_MAX_PATH + 2 + 4 + 1 \
+    + COAP_BLOCK_SIZE)
+
+// Longest payload of an acknowledgement, e.g. the offset of an upload slot
+#define COAP_ACK_PAYLOAD 8
+
+// Size of the buffer for the acknowledgements: header, token, Max-Age and
+// Block1 option, payload marker and payload
+#define COAP_ACK_SIZE (4 + 2 + 5 + 5 + 1 + COAP_ACK_PAYLOAD)
+
+class CoapClient {
+public:
+  CoapClient(Modem &modem);
+
+  /**
+   * Starts the ids of the messages at a random value, so a restarted station
+   * isn't taken for a duplicate. random() has to be seeded before.
+   */
+  void begin();
+
+  /**
+   * Sends a confirmable POST request over the open UDP socket of the modem.
+   * The result is the response code (e.g. 201 for 2.01 Created) or -1 if the
+   * server didn't respond.
+   * @param  pt   Given state of the protothread
+   * @param  path Given Uri-Path of the request
+   * @param  body Given writer of the payload
+   * @return Returns PT_WAITING until the request ended.
+   */
+  uint8_t post(Pt *pt, const char *path, BodyWriter body);
+
+  /**
+   * @return Returns the result of the last request which ended.
+   */
+  int result() const { return code; }
+
+  /**
+   * @return Returns the Max-Age in s of the last response, which tells an
+   *         overloaded server's client how long to hold off.
+   */
+  uint32_t maxAge() const { return age; }
+
+  /**
+   * Copies the payload of the last response as text.
+   * @param text Copied payload, empty if there's none
+   * @param size Given size of the buffer for the text
+   */
+  void responseText(char *text, uint8_t size) const;
+
+  /**
+   * @return Returns the number of bytes sent and received since the start.
+   */
+  uint32_t bytes() const { return byteCount; }
+
+  /**
+   * @return Returns the number of round trips since the start.
+   */
+  uint16_t roundTrips() const { return roundTripCount; }
+
+protected:
+
+  /**
+   * Sends a datagram over the open UDP socket of the driver of the station
+   * (see Modem::udpSend()).
+   * @param  pt     Given state of the protothread
+   * @param  data   Given data of the datagram
+   * @param  length Given length of the data
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  virtual uint8_t udpSend(Pt *pt, const uint8_t *data, uint8_t length) = 0;
+
+  /**
+   * Reads a datagram of the driver of the station without waiting (see
+   * Modem::udpRead()).
+   * @param  buffer Given buffer for the datagram
+   * @param  size   Given size of the buffer
+   * @return Returns the length of the datagram or -1 if there's none.
+   */
+  virtual int udpRead(uint8_t *buffer, uint8_t size) = 0;
+
+private:
+
+  /**
+   * Builds the message of the current block.
+   * @param path Given Uri-Path of the request
+   * @param body Given writer of the payload
+   */
+  void buildMessage(const char *path, BodyWriter body);
+
+  /**
+   * Reads the acknowledgement of the current message without waiting.
+   * @return Returns true if the acknowledgement was received.
+   */
+  boolean receiveAck();
+
+  Modem &modem;
+  uint16_t messageId;
+  uint32_t byteCount;
+  uint16_t roundTripCount;
+
+  // State of the request which is kept while waiting
+  Pt send;
+  uint8_t message[COAP_MESSAGE_SIZE];
+  uint8_t messageLength;
+  uint8_t ack[COAP_ACK_SIZE];
+  uint16_t token;
+  uint32_t length;
+  uint32_t offset;
+  uint16_t block;
+  uint8_t size;
+  boolean more;
+  uint8_t attempt;
+  unsigned long start;
+  unsigned long timeout;
+  int code;
+  uint32_t age;
+  uint8_t payloadStart;
+  uint8_t payloadLength;
+};
+
+/**
+ * Holds a CoAP client only if the station uploads with CoAP, so the stations
+ * which upload with HTTP neither spend RAM on its buffers nor link its code
+ * or the UDP flows of their driver. The empty variant ends every request at
+ * once without a response.
+ */
+template <bool used, class Driver>
+class OptionalCoapClient {
+public:
+  OptionalCoapClient(Driver &) {
+  }
+
+  void begin() {}
+
+  uint8_t post(Pt *, const char *, BodyWriter) { return PT_ENDED; }
+
+  int result() const { return -1; }
+
+  uint32_t maxAge() const { return COAP_MAX_AGE; }
+
+  void responseText(char *text, uint8_t) const { text[0] = '\0'; }
+
+  uint32_t bytes() const { return 0; }
+
+  uint16_t roundTrips() const { return 0; }
+};
+
+template <class Driver>
+class OptionalCoapClient<true, Driver> : public CoapClient {
+public:
+  OptionalCoapClient(Driver &driver) : CoapClient(driver), driver(driver) {
+  }
+
+protected:
+  uint8_t udpSend(Pt *pt, const uint8_t *data, uint8_t length) {
+    return driver.udpSend(pt, data, length);
+  }
+
+  int udpRead(uint8_t *buffer, uint8_t size) {
+    return driver.udpRead(buffer, size);
+  }
+
+private:
+  Driver &driver;
+};
+
+#endif
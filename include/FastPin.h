@@ -0,0 +1,87 @@
+#ifndef FAST_PIN_H
+#define FAST_PIN_H
+
+#include "Arduino.h"
+
+/**
+ * Pin driver with direct access to the port registers of the ATmega328P.
+ * The Arduino pin number is a template parameter, so the mapping to the
+ * PORTx/PINx/DDRx register and the bit is done by the compiler and every
+ * access ends up in a single sbi/cbi/sbic instruction instead of the lookup
+ * tables of digitalWrite() and digitalRead().
+ */
+
+/**
+ * Index of the port of a given Arduino pin (0: PORTD, 1: PORTB, 2: PORTC).
+ * @param  pin Given Arduino pin
+ * @return Returns the index of the port.
+ */
+constexpr uint8_t fastPinPort(uint8_t pin) {
+  return pin < 8 ? 0 : (pin < 14 ? 1 : 2);
+}
+
+/**
+ * Bit of a given Arduino pin inside of its port.
+ * @param  pin Given Arduino pin
+ * @return Returns the bit of the pin.
+ */
+constexpr uint8_t fastPinBit(uint8_t pin) {
+  return pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14);
+}
+
+// Mapping of the pins of the Nano (D0-D7, D8-D13, A0-A5)
+static_assert(fastPinPort(0) == 0 && fastPinBit(0) == 0, "D0 is PD0");
+static_assert(fastPinPort(7) == 0 && fastPinBit(7) == 7, "D7 is PD7");
+static_assert(fastPinPort(8) == 1 && fastPinBit(8) == 0, "D8 is PB0");
+static_assert(fastPinPort(13) == 1 && fastPinBit(13) == 5, "D13 is PB5");
+static_assert(fastPinPort(14) == 2 && fastPinBit(14) == 0, "A0 is PC0");
+static_assert(fastPinPort(19) == 2 && fastPinBit(19) == 5, "A5 is PC5");
+
+template <uint8_t pin>
+class FastPin {
+public:
+  static_assert(pin < 20, "pin has no digital port on the ATmega328P");
+
+  // Mask of the pin inside of its port
+  static constexpr uint8_t MASK = 1 << fastPinBit(pin);
+
+  /**
+   * Configures the pin as output.
+   */
+  static void output() { ddrReg() |= MASK; }
+
+  /**
+   * Configures the pin as input without pull up.
+   */
+  static void input() {
+    ddrReg() &= ~MASK;
+    portReg() &= ~MASK;
+  }
+
+  static void high() { portReg() |= MASK; }
+
+  static void low() { portReg() &= ~MASK; }
+
+  /**
+   * @return Returns true if the pin is high.
+   */
+  static boolean read() { return (pinReg() & MASK) != 0; }
+
+private:
+  static volatile uint8_t &portReg() {
+    return fastPinPort(pin) == 0 ? PORTD
+        : (fastPinPort(pin) == 1 ? PORTB : PORTC);
+  }
+
+  static volatile uint8_t &pinReg() {
+    return fastPinPort(pin) == 0 ? PIND
+        : (fastPinPort(pin) == 1 ? PINB : PINC);
+  }
+
+  static volatile uint8_t &ddrReg() {
+    return fastPinPort(pin) == 0 ? DDRD
+        : (fastPinPort(pin) == 1 ? DDRB : DDRC);
+  }
+};
+
+#endif
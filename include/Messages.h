@@ -0,0 +1,70 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include "Arduino.h"
+
+/**
+ * Catalogue of the sms texts. The texts are stored in flash per language and
+ * are already encoded in the GSM 03.38 default alphabet, which the module
+ * expects in text mode with AT+CSCS="GSM", so nothing is transcoded at
+ * runtime. A text consists of a title and, for the messages about the water,
+ * the current water level. Residents ask for the current level by a sms with
+ * the keyword of their language, which is answered in that language.
+ */
+
+// Marker for a sms which isn't a query
+#define NO_QUERY -1
+
+/**
+ * Codes of the messages.
+ */
+enum MessageCode {
+
+  // Current water level (answer to a query)
+  MSG_LEVEL,
+
+  // A critical point was reached
+  MSG_LEVEL_1_REACHED,
+  MSG_LEVEL_2_REACHED,
+  MSG_LEVEL_3_REACHED,
+
+  // The water is back under a critical point
+  MSG_LEVEL_1_CLEARED,
+  MSG_LEVEL_2_CLEARED,
+  MSG_LEVEL_3_CLEARED,
+
+  // Failures of the hardware, only sent to the admin
+  MSG_SENSOR_FAILURE,
+  MSG_RTC_FAILURE,
+
+  MESSAGE_COUNT
+};
+
+/**
+ * Languages of the catalogue.
+ */
+enum Language {
+  LANG_DE,
+  LANG_EN,
+
+  LANGUAGE_COUNT
+};
+
+/**
+ * Writes the GSM 03.38 encoded text of a message to the given output.
+ * @param out      Given output
+ * @param code     Given code of the message
+ * @param language Given language of the text
+ * @param level    Current water level above datum in cm
+ */
+void writeMessage(Print &out, MessageCode code, Language language, int level);
+
+/**
+ * Checks if the text of a received sms asks for the current level. Leading
+ * blanks and the case of the keyword are ignored.
+ * @param  text Given text of the sms
+ * @return Returns the language of the keyword (Language) or NO_QUERY.
+ */
+int parseQuery(const char *text);
+
+#endif
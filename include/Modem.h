@@ -0,0 +1,542 @@
+#ifndef MODEM_H
+#define MODEM_H
+
+#include "Arduino.h"
+#include "Protothread.h"
+#include "StreamWriter.h"
+
+/**
+ * Interface of the cellular modules. The AT command engine is shared by all
+ * drivers, every driver implements the network specific parts (bearer, power
+ * saving), so uploads and sms alerts are independent of the module. All flows
+ * which wait for the module are protothreads: they return PT_WAITING while
+ * the module is busy and PT_ENDED when they're done, their outcome is read
+ * with result() afterwards. Only one flow of a module may run at a time.
+ * The engine keeps a latency histogram and error counters per step of the
+ * flows, so a step which slows down over weeks (e.g. HTTPACTION) shows up.
+ * The flows aren't virtual: the station holds the driver of its profile and
+ * calls it directly, so the linker drops the flows of the transports the
+ * profile doesn't use (e.g. UDP and PDU sms of a HTTP station). Every driver
+ * implements the flows declared here, sleep() and wake() are optional.
+ */
+
+// Size of the buffer for one line of the module (a +CDS line has ~90 chars)
+#define AT_LINE_SIZE 96
+
+// Default time in ms to wait for the response of a command
+#define AT_TIMEOUT 2000
+
+// Final response of a successful command, kept in flash like all expected
+// responses
+extern const char atOk[] PROGMEM;
+
+// Time in ms to wait for the network to open a bearer
+#define BEARER_TIMEOUT 30000
+
+// Time in ms to wait for the response of the server
+#define HTTP_TIMEOUT 30000
+
+// Time in ms the module waits for the body of a request
+#define HTTP_DATA_TIMEOUT 10000
+
+// Time in ms to wait for the network to accept a sms
+#define SMS_TIMEOUT 60000
+
+// Marker for a power key which isn't connected
+#define NO_POWER_PIN 0xFF
+
+/*
+ * First octet of the outgoing sms: SMS-SUBMIT with a relative validity
+ * period and the status report request (SRR) bit set
+ */
+#define SMS_FIRST_OCTET "49"
+
+/*
+ * First octet of a data sms: SMS-SUBMIT with a relative validity period and
+ * a user data header (UDHI), without a status report
+ */
+#define PDU_FIRST_OCTET 0x51
+
+// Data coding scheme of a data sms: 8-bit data
+#define PDU_DATA_CODING 0x04
+
+// Relative validity period of the sms: 24 hours
+#define PDU_VALIDITY 167
+
+// Size of the user data of a sms in bytes
+#define SMS_DATA_SIZE 140
+
+// Size of the concatenation header (IEI 0) in front of every part
+#define SMS_UDH_SIZE 6
+
+// Number of bytes of the data per part of a data sms
+#define SMS_PART_SIZE (SMS_DATA_SIZE - SMS_UDH_SIZE)
+
+// Number of sms status reports which can wait to be read
+#define STATUS_REPORT_QUEUE 4
+
+// Number of received sms which can wait to be read
+#define INCOMING_SMS_QUEUE 4
+
+// Number of buckets of the latency histograms
+#define AT_LATENCY_BUCKETS 8
+
+/*
+ * Upper bound in ms of the first bucket, the bound doubles from bucket to
+ * bucket and the last bucket takes everything above
+ */
+#define AT_LATENCY_FIRST 256
+
+/*
+ * Waits inside of a protothread of a driver for the response of the command
+ * which was sent before, the protothread ends with a false result if the
+ * module doesn't respond as expected
+ */
+#define AT_WAIT(pt) \
+  do { \
+    PT_WAIT_UNTIL(pt, poll() != AT_PENDING); \
+    if (response() != AT_OK) { \
+      finish(false); \
+      PT_EXIT(pt); \
+    } \
+  } while (0)
+
+// Sends a command line inside of a protothread and waits for its response
+#define AT_COMMAND(pt, ...) \
+  do { \
+    sendCommand(__VA_ARGS__); \
+    AT_WAIT(pt); \
+  } while (0)
+
+// Waits inside of a protothread for a response of the module
+#define AT_EXPECT(pt, ...) \
+  do { \
+    expect(__VA_ARGS__); \
+    AT_WAIT(pt); \
+  } while (0)
+
+/**
+ * Status report of the network about the delivery of a sms.
+ */
+struct StatusReport {
+
+  // Message reference of the sms, as returned by +CMGS
+  uint8_t reference;
+
+  // Status of the delivery (TP-ST: 0 delivered, 0x20 to 0x3F still trying,
+  // from 0x40 on failed)
+  uint8_t status;
+};
+
+/**
+ * Steps of the flows, the latencies are kept per step.
+ */
+enum AtStep {
+
+  // Configuration, waking up and sending to sleep
+  AT_STEP_CONTROL,
+
+  // Attaching to the network and opening the bearer or socket
+  AT_STEP_BEARER,
+
+  // Transfer of the URL and body of a request or of a datagram
+  AT_STEP_REQUEST,
+
+  // The HTTP request itself, including the SSL handshake (HTTPACTION)
+  AT_STEP_ACTION,
+
+  // Closing HTTP, the bearer or the socket
+  AT_STEP_TEARDOWN,
+
+  // Sending and reading sms
+  AT_STEP_SMS,
+
+  AT_STEP_COUNT
+};
+
+/**
+ * Statistics of the responses of one step. The counters wrap around, they're
+ * never reset, so the server takes the difference to the previous upload and
+ * nothing gets lost if an upload fails.
+ */
+struct AtStats {
+
+  // Number of responses per latency bucket
+  uint16_t latency[AT_LATENCY_BUCKETS];
+
+  // Number of errors and timeouts
+  uint16_t errors;
+  uint16_t timeouts;
+};
+
+/**
+ * State of the response to the last command.
+ */
+enum AtResponse {
+  AT_PENDING,
+  AT_OK,
+  AT_ERROR,
+  AT_TIMED_OUT
+};
+
+class Modem {
+public:
+
+  /**
+   * @param serial   Serial connection to the module
+   * @param apn      Access point of the network
+   * @param apnUser  User of the access point
+   * @param apnPw    Password of the access point
+   * @param powerPin Pin connected to the power key of the module
+   */
+  Modem(Stream &serial, const __FlashStringHelper *apn,
+      const __FlashStringHelper *apnUser, const __FlashStringHelper *apnPw,
+      uint8_t powerPin = NO_POWER_PIN);
+
+  /**
+   * Configures the module after it was powered on. The result is false if the
+   * module isn't responding.
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t begin(Pt *pt);
+
+  /**
+   * Asks the module if it's registered in the network, which costs a single
+   * round trip. The result is true if it's registered (home or roaming).
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t checkNetwork(Pt *pt);
+
+  /**
+   * Attaches to the network and prepares a HTTP request. The result is false
+   * if the connection couldn't be established.
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t connect(Pt *pt);
+
+  /**
+   * Starts to transfer the URL of the HTTP request to the module.
+   * @return Returns the output to write the URL to.
+   */
+  Print &beginUrl();
+
+  /**
+   * Finishes the URL of the HTTP request. The result is false if the module
+   * didn't accept the URL.
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t endUrl(Pt *pt);
+
+  /**
+   * Sends the prepared HTTP request as POST with the given body. The body is
+   * streamed into the module, its length is precomputed by a first run. The
+   * result is the HTTP status code or 0 if there's no response.
+   * @param  pt   Given state of the protothread
+   * @param  body Given writer of the body
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t httpPost(Pt *pt, BodyWriter body);
+
+  /**
+   * Reads the first line of the body of the response to the HTTP request.
+   * The result is false if it couldn't be read. Lines longer than the buffer
+   * are truncated.
+   * @param  pt   Given state of the protothread
+   * @param  text Read line of the body
+   * @param  size Given size of the buffer for the line
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t httpRead(Pt *pt, char *text, uint8_t size);
+
+  /**
+   * Terminates HTTP and the connection to the network.
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t disconnect(Pt *pt);
+
+  /**
+   * Attaches to the network and opens a UDP socket to the given server. The
+   * result is false if the socket couldn't be opened.
+   * @param  pt   Given state of the protothread
+   * @param  host Given host of the server
+   * @param  port Given port of the server
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t udpOpen(Pt *pt, const __FlashStringHelper *host, uint16_t port);
+
+  /**
+   * Sends a datagram over the open UDP socket. The result is false if the
+   * module didn't send the datagram.
+   * @param  pt     Given state of the protothread
+   * @param  data   Given data of the datagram, it has to stay unchanged
+   *                until the flow ended
+   * @param  length Given length of the data
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t udpSend(Pt *pt, const uint8_t *data, uint8_t length);
+
+  /**
+   * Reads what the module received on the open UDP socket without waiting.
+   * Datagrams longer than the buffer are truncated.
+   * @param  buffer Given buffer for the datagram, it has to stay the same
+   *                until a datagram was returned
+   * @param  size   Given size of the buffer
+   * @return Returns the length of the whole datagram, which exceeds the size
+   *         if it was truncated, or -1 if no datagram is complete yet.
+   */
+  int udpRead(uint8_t *buffer, uint8_t size);
+
+  /**
+   * Closes the UDP socket and the connection to the network.
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t udpClose(Pt *pt);
+
+  /**
+   * Sends a sms with a request for a status report. The result is true if
+   * the network accepted the sms, its message reference is read with
+   * smsReference() afterwards.
+   * @param  pt     Given state of the protothread
+   * @param  number Given number of the recipient
+   * @param  text   Given writer of the text, the text is streamed into the
+   *                module in the character set of the module (GSM 03.38)
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t sendSms(Pt *pt, const char *number, BodyWriter text);
+
+  /**
+   * Sends one part of binary data as sms in PDU mode, e.g. to the sms gateway
+   * of the server. The data is split into parts of SMS_PART_SIZE bytes, every
+   * part starts with the concatenation header of 3GPP TS 23.040 (reference,
+   * number of parts, number of the part counting from 1), so the receiver
+   * reassembles them. The module is switched back to TEXT mode afterwards.
+   * The result is true if the network accepted the part.
+   * @param  pt        Given state of the protothread
+   * @param  number    Given number of the recipient
+   * @param  data      Given writer of the whole data
+   * @param  reference Given reference of the data, the same for all parts
+   * @param  part      Given index of the part, counting from 0
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t sendDataSms(Pt *pt, const __FlashStringHelper *number,
+      BodyWriter data, uint8_t reference, uint8_t part);
+
+  /**
+   * Reads a received sms from the storage of the module and deletes it
+   * there. The result is false if the sms couldn't be read. Texts longer than
+   * the buffer are truncated.
+   * @param  pt         Given state of the protothread
+   * @param  index      Given index of the sms in the storage (+CMTI)
+   * @param  number     Read number of the sender
+   * @param  numberSize Given size of the buffer for the number
+   * @param  text       Read text of the sms
+   * @param  textSize   Given size of the buffer for the text
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t readSms(Pt *pt, uint8_t index, char *number, uint8_t numberSize,
+      char *text, uint8_t textSize);
+
+  /**
+   * Lets the module enter its power saving mode until it's needed again.
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t sleep(Pt *pt);
+
+  /**
+   * Wakes the module up from its power saving mode. The result is false if
+   * the module isn't responding.
+   * @param  pt Given state of the protothread
+   * @return Returns PT_WAITING until the flow ended.
+   */
+  uint8_t wake(Pt *pt);
+
+  /**
+   * @return Returns the result of the last flow which ended.
+   */
+  int result() const { return lastResult; }
+
+  /**
+   * @return Returns the message reference of the last sms which was sent.
+   */
+  uint8_t smsReference() const { return lastReference; }
+
+  /**
+   * @return Returns the length of the body of the last HTTP response.
+   */
+  uint16_t responseLength() const { return contentLength; }
+
+  /**
+   * Reads what the module sent on its own while no flow is running, the
+   * output is handed off to the serial monitor, status reports and the
+   * indications of received sms are kept.
+   */
+  void idle();
+
+  /**
+   * Takes the oldest status report which was received.
+   * @param  report Taken status report
+   * @return Returns false if no status report is waiting.
+   */
+  boolean nextStatusReport(StatusReport &report);
+
+  /**
+   * @return Returns true if a received sms waits to be read.
+   */
+  boolean smsWaiting() const { return incomingCount > 0; }
+
+  /**
+   * Takes the storage index of the oldest sms which was received.
+   * @param  index Taken index
+   * @return Returns false if no sms waits to be read.
+   */
+  boolean nextIncomingSms(uint8_t &index);
+
+  /**
+   * @return Returns the number of command lines sent to the module, each of
+   *         them is one round trip.
+   */
+  uint16_t roundTrips() const { return lineCount; }
+
+  /**
+   * Starts counting the round trips again, e.g. before an upload.
+   */
+  void resetRoundTrips() { lineCount = 0; }
+
+  /**
+   * @param  step Given step of the flows
+   * @return Returns the statistics of the responses of the step.
+   */
+  const AtStats &stats(AtStep step) const { return stepStats[step]; }
+
+protected:
+
+  /**
+   * Sends a command line, its response is awaited by poll(). Several
+   * commands can be concatenated on one line ("AT+A;+B"), the module answers
+   * them with one final OK, so they cost a single round trip.
+   * @param cmd     Given command line without the line ending
+   * @param expect  Expected response in flash
+   * @param timeout Time in ms to wait for the response
+   */
+  void sendCommand(const __FlashStringHelper *cmd, PGM_P expect = atOk,
+      unsigned long timeout = AT_TIMEOUT);
+
+  /**
+   * Starts to wait for a line of the module containing the expected
+   * response, e.g. after a command line was written by the caller.
+   * @param expect  Expected response in flash
+   * @param timeout Time in ms to wait for the response
+   */
+  void expect(PGM_P expect, unsigned long timeout = AT_TIMEOUT);
+
+  /**
+   * Reads what the module sent so far without waiting. The output of the
+   * module is handed off to the serial monitor.
+   * @return Returns AT_PENDING until the expected response, an error or a
+   *         timeout was received.
+   */
+  AtResponse poll();
+
+  /**
+   * @return Returns the state of the response to the last command.
+   */
+  AtResponse response() const { return state; }
+
+  /**
+   * Prepares sending a new command line, which is written by the caller.
+   */
+  void beginCommand();
+
+  /**
+   * Drops everything the module sent without being asked for.
+   */
+  void flush();
+
+  /**
+   * Sets the result of the flow which ends.
+   * @param value Given result
+   */
+  void finish(int value) { lastResult = value; }
+
+  /**
+   * Sets the message reference of the sms which was sent.
+   * @param reference Given message reference
+   */
+  void setSmsReference(uint8_t reference) { lastReference = reference; }
+
+  /**
+   * Sets the length of the body of the HTTP response.
+   * @param length Given length
+   */
+  void setResponseLength(uint16_t length) { contentLength = length; }
+
+  /**
+   * Sets the step the following responses are counted for.
+   * @param step Given step
+   */
+  void measure(AtStep step) { currentStep = step; }
+
+  Stream &serial;
+  const __FlashStringHelper *apn;
+  const __FlashStringHelper *apnUser;
+  const __FlashStringHelper *apnPw;
+  uint8_t powerPin;
+
+  // Last line received from the module
+  char line[AT_LINE_SIZE];
+
+  // Start of a wait inside of a flow, e.g. for the power key
+  unsigned long timer;
+
+private:
+
+  /**
+   * Reads the available chars of the module into the line buffer. Prompts
+   * (">") count as a line of their own. Status reports and the indications
+   * of received sms are taken out.
+   * @return Returns true if a line which isn't taken out is complete.
+   */
+  boolean readLine();
+
+  /**
+   * Keeps the status report in the line buffer (+CDS: <fo>,<mr>,...,<st>).
+   */
+  void keepStatusReport();
+
+  /**
+   * Keeps the index of a received sms in the line buffer (+CMTI: <mem>,<n>).
+   */
+  void keepIncomingSms();
+
+  /**
+   * Ends the wait for the response and counts it for the current step.
+   * @param  response Given state of the response
+   * @return Returns the given state.
+   */
+  AtResponse settle(AtResponse response);
+
+  PGM_P expected;
+  unsigned long start;
+  unsigned long timeout;
+  uint8_t length;
+  AtResponse state;
+  int lastResult;
+  uint16_t lineCount;
+  uint8_t lastReference;
+  uint16_t contentLength;
+  StatusReport reports[STATUS_REPORT_QUEUE];
+  uint8_t reportCount;
+  uint8_t incoming[INCOMING_SMS_QUEUE];
+  uint8_t incomingCount;
+  AtStep currentStep;
+  AtStats stepStats[AT_STEP_COUNT];
+};
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include "Arduino.h"
+#include "Modem.h"
+
+/**
+ * Compact binary payload of the uploads. A batch starts with the version of
+ * the format, the id of the station, the sequence number of the first
+ * reading and the number of readings, so the server is able to tell the
+ * stations of a fleet apart and to drop readings it already stored. It's
+ * followed by the readings, the sms delivery statistics (number of
+ * recipients, then one entry each) and the statistics of the module (number
+ * of steps, then one entry each, or just 0 if they aren't included), the
+ * batch ends with the statistics of the connection. All values are stored
+ * big-endian.
+ */
+
+// Version of the payload format
+#define PAYLOAD_VERSION 7
+
+// Size of the header of a batch
+#define BATCH_HEADER_SIZE 6
+
+// Size of one encoded reading
+#define READING_SIZE 18
+
+// Size of the encoded delivery statistics of one recipient
+#define DELIVERY_STATS_SIZE 5
+
+// Size of the encoded statistics of one step of the module
+#define AT_STATS_SIZE (2 * AT_LATENCY_BUCKETS + 4)
+
+// Size of the encoded statistics of the connection
+#define LINK_STATS_SIZE 4
+
+// Diagnostic flag: an sms alert took longer than its SLO
+#define DIAG_ALERT_SLO 0x01
+
+// Diagnostic flags of the sensor anomalies (ANOMALY_* of all sensors)
+#define DIAG_ANOMALY_SHIFT 1
+
+/**
+ * One reading of the station.
+ */
+struct Reading {
+
+  // Unix time of the reading
+  uint32_t time;
+
+  // Water level above datum in cm
+  int16_t level;
+
+  // Average, lowest and highest supply voltage in mV
+  uint16_t vcc;
+  uint16_t vmin;
+  uint16_t vmax;
+
+  // Temperature in degrees Celsius
+  int8_t temperature;
+
+  // Self-diagnostic flags (DIAG_*)
+  uint8_t diagnostics;
+
+  // Median and 95th percentile of the alert latency in units of 100 ms
+  uint16_t alertP50;
+  uint16_t alertP95;
+};
+
+/**
+ * Statistics of the sms deliveries to one recipient since the last upload.
+ */
+struct DeliveryStats {
+
+  /*
+   * Number of sms the network confirmed as delivered, it stops at 255 and
+   * the latency turns into a moving average then
+   */
+  uint8_t delivered;
+
+  // Number of sms the network failed to deliver
+  uint8_t failed;
+
+  // Number of sms without a status report
+  uint8_t unconfirmed;
+
+  // Average time in s from sending a sms until it was delivered
+  uint16_t latency;
+};
+
+/**
+ * Statistics of the failed connections to the server. The counters wrap
+ * around like the ones of the module, so the server takes the differences.
+ */
+struct LinkStats {
+
+  // Number of failed attempts to reach the server
+  uint16_t failures;
+
+  // Time in s the module was busy with failed attempts (wasted energy)
+  uint16_t wastedSeconds;
+};
+
+/**
+ * Encodes the header of a batch.
+ * @param buffer    Given buffer of at least BATCH_HEADER_SIZE bytes
+ * @param stationId Given id of the station
+ * @param sequence  Sequence number of the first reading in the batch
+ * @param count     Number of readings in the batch
+ */
+void encodeBatchHeader(uint8_t *buffer, uint16_t stationId,
+    uint16_t sequence, uint8_t count);
+
+/**
+ * Encodes a reading.
+ * @param buffer  Given buffer of at least READING_SIZE bytes
+ * @param reading Given reading
+ */
+void encodeReading(uint8_t *buffer, const Reading &reading);
+
+/**
+ * Encodes the delivery statistics of a recipient.
+ * @param buffer Given buffer of at least DELIVERY_STATS_SIZE bytes
+ * @param stats  Given statistics
+ */
+void encodeDeliveryStats(uint8_t *buffer, const DeliveryStats &stats);
+
+/**
+ * Encodes the statistics of one step of the module.
+ * @param buffer Given buffer of at least AT_STATS_SIZE bytes
+ * @param stats  Given statistics
+ */
+void encodeAtStats(uint8_t *buffer, const AtStats &stats);
+
+/**
+ * Encodes the statistics of the connection.
+ * @param buffer Given buffer of at least LINK_STATS_SIZE bytes
+ * @param stats  Given statistics
+ */
+void encodeLinkStats(uint8_t *buffer, const LinkStats &stats);
+
+/**
+ * Writes the encoded header of a batch to the given output.
+ * @param out       Given output
+ * @param stationId Given id of the station
+ * @param sequence  Sequence number of the first reading in the batch
+ * @param count     Number of readings in the batch
+ */
+void writeBatchHeader(Print &out, uint16_t stationId, uint16_t sequence,
+    uint8_t count);
+
+/**
+ * Writes an encoded reading to the given output.
+ * @param out     Given output
+ * @param reading Given reading
+ */
+void writeReading(Print &out, const Reading &reading);
+
+/**
+ * Writes the encoded delivery statistics of all recipients to the given
+ * output.
+ * @param out   Given output
+ * @param stats Given statistics per recipient
+ * @param count Number of recipients
+ */
+void writeDeliveryStats(Print &out, const DeliveryStats stats[],
+    uint8_t count);
+
+/**
+ * Writes the encoded statistics of the first steps of the module to the given
+ * output.
+ * @param out   Given output
+ * @param stats Given statistics per step
+ * @param count Number of steps (0 to leave the statistics out)
+ */
+void writeAtStats(Print &out, const AtStats stats[], uint8_t count);
+
+/**
+ * Writes the encoded statistics of the connection to the given output.
+ * @param out   Given output
+ * @param stats Given statistics
+ */
+void writeLinkStats(Print &out, const LinkStats &stats);
+
+#endif
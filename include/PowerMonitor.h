@@ -0,0 +1,123 @@
+#ifndef POWER_MONITOR_H
+#define POWER_MONITOR_H
+
+#include "Arduino.h"
+
+/**
+ * Monitoring of the supply voltage. Vcc is messured against the internal
+ * 1.1 V bandgap reference, optionally the battery voltage is messured over an
+ * ADC divider. The supply state derived from it is used to degrade the
+ * station before the SIM800L transmit bursts are able to brown out the Nano.
+ */
+
+// Voltage of the internal bandgap reference in mV (calibrate per board)
+#define BANDGAP_MV 1100L
+
+// Marker for a battery which isn't monitored
+#define NO_BATTERY_PIN 0xFF
+
+// Hysteresis in mV before a worse supply state is left again
+#define POWER_HYSTERESIS 100
+
+/*
+ * Number of samples in a row which have to ask for a worse supply state
+ * before it's entered, so a short dip during a transmit burst is ignored
+ */
+#define POWER_CONFIRM 4
+
+/**
+ * Supply states of the station.
+ */
+enum PowerState {
+
+  // Everything allowed
+  POWER_NORMAL,
+
+  // Reduced sampling and delayed bulk uploads
+  POWER_LOW,
+
+  // Only alerts are sent
+  POWER_CRITICAL
+};
+
+class PowerMonitor {
+public:
+
+  /**
+   * @param lowMv      Voltage in mV below which the supply is low
+   * @param criticalMv Voltage in mV below which the supply is critical
+   * @param batteryPin Analog pin of the battery divider or NO_BATTERY_PIN
+   * @param dividerNum Numerator of the battery divider ratio
+   * @param dividerDen Denominator of the battery divider ratio
+   */
+  PowerMonitor(uint16_t lowMv, uint16_t criticalMv,
+      uint8_t batteryPin = NO_BATTERY_PIN, uint8_t dividerNum = 1,
+      uint8_t dividerDen = 1);
+
+  /**
+   * Messures the voltages and updates the supply state and the trend.
+   */
+  void sample();
+
+  /**
+   * @return Returns the last messured Vcc in mV.
+   */
+  uint16_t vcc() const { return lastVcc; }
+
+  /**
+   * @return Returns the last messured battery voltage in mV (Vcc if there's
+   *         no battery divider).
+   */
+  uint16_t battery() const { return lastBattery; }
+
+  /**
+   * @return Returns the current supply state.
+   */
+  PowerState state() const { return currentState; }
+
+  /**
+   * @return Returns the lowest voltage in mV since the last trend reset.
+   */
+  uint16_t trendMin() const { return minMv; }
+
+  /**
+   * @return Returns the highest voltage in mV since the last trend reset.
+   */
+  uint16_t trendMax() const { return maxMv; }
+
+  /**
+   * @return Returns the average voltage in mV since the last trend reset.
+   */
+  uint16_t trendAvg() const;
+
+  /**
+   * Starts a new trend, e.g. after the trend was uploaded.
+   */
+  void resetTrend();
+
+private:
+
+  /**
+   * Messures Vcc against the internal bandgap reference.
+   * @return Returns Vcc in mV.
+   */
+  uint16_t readVcc();
+
+  uint16_t lowMv;
+  uint16_t criticalMv;
+  uint8_t batteryPin;
+  uint8_t dividerNum;
+  uint8_t dividerDen;
+  uint16_t lastVcc;
+  uint16_t lastBattery;
+  PowerState currentState;
+
+  // Number of samples in a row which asked for a worse state
+  uint8_t worseSamples;
+  uint16_t minMv;
+  uint16_t maxMv;
+  uint32_t sumMv;
+  uint16_t samples;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef PROTOTHREAD_H
+#define PROTOTHREAD_H
+
+#include "Arduino.h"
+
+/**
+ * Stackless coroutines (protothreads) for the flows which have to wait for
+ * the module or for time to pass. A protothread is a function which returns
+ * whenever it would have to wait and continues at the same line when it's
+ * called again, so the flow stays readable from top to bottom while the loop
+ * keeps running. The state of a protothread is the line it waits at, local
+ * variables aren't kept between two calls, so everything which has to survive
+ * a wait is stored outside of the function. Because the protothreads are
+ * built on a switch statement, they mustn't contain a switch statement and
+ * at most one wait per source line.
+ */
+
+/**
+ * State of a protothread.
+ */
+struct Pt {
+
+  // Line the protothread waits at (0 if it didn't start yet)
+  uint16_t line;
+};
+
+static_assert(sizeof(Pt) == 2, "state of a protothread has to stay small");
+
+// Return value of a protothread which is still waiting
+#define PT_WAITING 0
+
+// Return value of a protothread which ended
+#define PT_ENDED 1
+
+// Initializes the state of a protothread, so it starts from the beginning
+#define PT_INIT(pt) ((pt)->line = 0)
+
+/*
+ * Marks the jump from setting the line into its case label as intended, so
+ * the waits don't trigger -Wimplicit-fallthrough
+ */
+#if defined(__GNUC__) && __GNUC__ >= 7
+#define PT_FALLTHROUGH __attribute__((fallthrough))
+#else
+#define PT_FALLTHROUGH
+#endif
+
+// Starts the body of a protothread
+#define PT_BEGIN(pt) switch ((pt)->line) { case 0:
+
+// Ends the body of a protothread, the next call starts it again
+#define PT_END(pt) } PT_INIT(pt); return PT_ENDED
+
+// Waits until the given condition is true
+#define PT_WAIT_UNTIL(pt, condition) \
+  do { \
+    (pt)->line = __LINE__; PT_FALLTHROUGH; case __LINE__: \
+    if (!(condition)) { \
+      return PT_WAITING; \
+    } \
+  } while (0)
+
+// Gives the other protothreads the chance to run once
+#define PT_YIELD(pt) \
+  do { \
+    (pt)->line = __LINE__; \
+    return PT_WAITING; case __LINE__:; \
+  } while (0)
+
+// Leaves the protothread
+#define PT_EXIT(pt) \
+  do { \
+    PT_INIT(pt); \
+    return PT_ENDED; \
+  } while (0)
+
+// Runs a child protothread with the given state and waits until it ended
+#define PT_SPAWN(pt, child, thread) \
+  do { \
+    PT_INIT(child); \
+    PT_WAIT_UNTIL(pt, (thread) == PT_ENDED); \
+  } while (0)
+
+// Runs a protothread until it ended, blocking the caller (e.g. in setup())
+#define PT_RUN(thread) while ((thread) == PT_WAITING)
+
+#endif
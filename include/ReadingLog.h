@@ -0,0 +1,108 @@
+#ifndef READING_LOG_H
+#define READING_LOG_H
+
+#include "Arduino.h"
+#include "Payload.h"
+#include "Recipients.h"
+
+/**
+ * Store-and-forward log of the readings in the EEPROM, behind the recipient
+ * table. Every reading gets a sequence number and is kept as a ring buffer
+ * until the server acknowledged it, so no reading is lost while the network
+ * or the server is down. A record is written with its checksum last and
+ * acknowledged by a single byte, so a reset in the middle of a write leaves
+ * at most that record invalid. The position in the ring is recovered on
+ * startup from the sequence numbers, there's no separate pointer which would
+ * wear out the EEPROM.
+ */
+
+// Number of records in the ring
+#define LOG_SLOTS 40
+
+// Highest number of readings sent with one upload
+#define LOG_BATCH 16
+
+// EEPROM address of the ring
+#define LOG_ADDR (RECIPIENT_ADDR + RECIPIENT_COUNT * sizeof(Recipient))
+
+// State of a record which waits for the acknowledgement of the server
+#define LOG_PENDING 0xA5
+
+// State of a record which was acknowledged by the server
+#define LOG_ACKED 0x5A
+
+/**
+ * Record of the ring as it is stored in the EEPROM.
+ */
+struct LogRecord {
+
+  // Sequence number of the reading, counting up from the first reading
+  uint16_t sequence;
+
+  // State of the record (LOG_PENDING or LOG_ACKED)
+  uint8_t state;
+
+  // Encoded reading
+  uint8_t reading[READING_SIZE];
+
+  // Checksum over the sequence number and the reading
+  uint8_t checksum;
+};
+
+static_assert(LOG_ADDR + LOG_SLOTS * sizeof(LogRecord) <= E2END + 1,
+    "the reading log doesn't fit in the EEPROM");
+
+class ReadingLog {
+public:
+  ReadingLog();
+
+  /**
+   * Recovers the position in the ring and the pending readings from the
+   * EEPROM. Has to be called once on startup.
+   */
+  void recover();
+
+  /**
+   * Appends a reading. If the ring is full, the oldest pending reading is
+   * dropped.
+   * @param reading Given reading
+   */
+  void append(const Reading &reading);
+
+  /**
+   * @return Returns the number of readings which weren't acknowledged yet.
+   */
+  uint8_t pending() const { return count; }
+
+  /**
+   * @return Returns the sequence number of the oldest pending reading.
+   */
+  uint16_t firstSequence() const { return sequence - count; }
+
+  /**
+   * Writes the oldest pending readings encoded to the given output.
+   * @param out    Given output
+   * @param number Number of readings (at most the pending ones)
+   * @param skip   Number of the oldest pending readings to leave out
+   */
+  void write(Print &out, uint8_t number, uint8_t skip = 0) const;
+
+  /**
+   * Marks the oldest pending readings as acknowledged by the server.
+   * @param number Number of readings (at most the pending ones)
+   */
+  void acknowledge(uint8_t number);
+
+private:
+
+  // Slot of the next record
+  uint8_t head;
+
+  // Number of pending records in front of the head
+  uint8_t count;
+
+  // Sequence number of the next record
+  uint16_t sequence;
+};
+
+#endif
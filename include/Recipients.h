@@ -0,0 +1,81 @@
+#ifndef RECIPIENTS_H
+#define RECIPIENTS_H
+
+#include "Arduino.h"
+#include "Calibration.h"
+#include "Messages.h"
+
+/**
+ * Table of the sms recipients in the EEPROM, behind the calibration. Every
+ * entry holds the number and the language of one recipient, the first entry
+ * is the admin, who also gets the failures of the hardware. Empty or invalid
+ * entries are skipped.
+ */
+
+// Number of entries in the table
+#define RECIPIENT_COUNT 5
+
+// Size of a number in international format including the terminator
+#define NUMBER_SIZE 17
+
+/*
+ * Lowest number of digits of a number which gets an answer, shorter ones are
+ * short codes of the network or of services
+ */
+#define NUMBER_MIN_DIGITS 7
+
+// EEPROM address of the table
+#define RECIPIENT_ADDR (CALIBRATION_ADDR + sizeof(Calibration))
+
+// Marker of a used entry in the EEPROM
+#define RECIPIENT_MAGIC 0xA5
+
+/**
+ * Entry of the table as it is stored in the EEPROM.
+ */
+struct Recipient {
+  uint8_t magic;
+
+  // Number of the recipient, e.g. "+4915112345678"
+  char number[NUMBER_SIZE];
+
+  // Language of the texts (Language)
+  uint8_t language;
+
+  // Checksum over all fields above
+  uint8_t checksum;
+};
+
+/**
+ * Loads an entry of the table from the EEPROM.
+ * @param  index     Given index of the entry
+ * @param  recipient Loaded entry
+ * @return Returns false if the entry is empty or invalid.
+ */
+boolean loadRecipient(uint8_t index, Recipient &recipient);
+
+/**
+ * Stores an entry of the table in the EEPROM.
+ * @param  index     Given index of the entry
+ * @param  recipient Given entry
+ * @return Returns false if the index or the entry is invalid.
+ */
+boolean saveRecipient(uint8_t index, Recipient &recipient);
+
+/**
+ * Clears an entry of the table in the EEPROM.
+ * @param  index Given index of the entry
+ * @return Returns false if the index is invalid.
+ */
+boolean removeRecipient(uint8_t index);
+
+/**
+ * Checks if the sender of a received sms can be answered: an optional "+"
+ * and at least NUMBER_MIN_DIGITS digits. Alphanumeric senders and short codes
+ * can't be answered.
+ * @param  number Given number of the sender
+ * @return Returns true if the number can be answered.
+ */
+boolean isReplyNumber(const char *number);
+
+#endif
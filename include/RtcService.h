@@ -0,0 +1,87 @@
+#ifndef RTC_SERVICE_H
+#define RTC_SERVICE_H
+
+#include "Arduino.h"
+#include "RTClib.h"
+
+/**
+ * Cached access to the DS3231 rtc module. The registers of the module (time,
+ * status and temperature) are read in one I2C transaction, afterwards the time
+ * is extrapolated with millis() until a periodic resync is due or the next
+ * slot of the station is close, so the bus is idle for most of the loops.
+ */
+
+// I2C address of the DS3231
+#define DS3231_ADDRESS 0x68
+
+// Clock of the I2C bus (fast mode, supported by the DS3231)
+#define I2C_CLOCK 400000L
+
+// Interval in ms after which the cached time is read again from the module
+#define RTC_RESYNC 300000L
+
+// Time in s before a slot in which the cached time is read again
+#define RTC_SLOT_GUARD 5
+
+class RtcService {
+public:
+  RtcService();
+
+  /**
+   * Starts the I2C bus in fast mode and reads the module for the first time.
+   * @return Returns false if the module isn't responding.
+   */
+  boolean begin();
+
+  /**
+   * Returns the current time, read from the module only if the cached time is
+   * too old or a slot is close.
+   * @return Returns the current time.
+   */
+  DateTime now();
+
+  /**
+   * Sets the slots of the station (e.g. uploads every 10 minutes, 317 s after
+   * the full 10 minutes), the time is read from the module shortly before
+   * every slot.
+   * @param minutes Given period in minutes
+   * @param offset  Given offset of the slots in s (below the period)
+   */
+  void setSlot(uint8_t minutes, uint16_t offset) {
+    slotPeriod = minutes;
+    slotOffset = offset;
+  }
+
+  /**
+   * Reads time, status and temperature from the module in one transaction.
+   * @return Returns false if the module isn't responding.
+   */
+  boolean sync();
+
+  /**
+   * @return Returns true if the oscillator of the module stopped, so the time
+   *         isn't valid any more.
+   */
+  boolean lostPower() const { return oscillatorStopped; }
+
+  /**
+   * @return Returns the temperature of the module in 1/4 degrees Celsius.
+   */
+  int16_t temperature() const { return quarterDegrees; }
+
+  /**
+   * @return Returns the number of I2C transactions since the start.
+   */
+  uint32_t transactions() const { return transactionCount; }
+
+private:
+  uint32_t syncTime;
+  unsigned long syncMillis;
+  uint8_t slotPeriod;
+  uint16_t slotOffset;
+  boolean oscillatorStopped;
+  int16_t quarterDegrees;
+  uint32_t transactionCount;
+};
+
+#endif
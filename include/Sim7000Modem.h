@@ -0,0 +1,50 @@
+#ifndef SIM7000_MODEM_H
+#define SIM7000_MODEM_H
+
+#include "Sim800Modem.h"
+
+/**
+ * Driver of the SIM7000 NB-IoT/LTE-M modules. The HTTP and sms commands are
+ * the same as of the SIM800L, but between the uploads the module is kept in
+ * the Power Saving Mode (PSM) of the network with eDRX paging, so its idle
+ * current is a few uA. In PSM the module isn't reachable, it's woken up again
+ * by its power key. Incoming sms are delivered after the module woke up.
+ */
+
+// Preferred mode: LTE only
+#define SIM7000_NETWORK_MODE "38"
+
+// Preferred access technology: 1 = LTE-M, 2 = NB-IoT, 3 = both
+#define SIM7000_ACCESS "3"
+
+// Requested periodic TAU (T3412 extended): 1 hour
+#define PSM_PERIODIC_TAU "00100001"
+
+// Requested active time (T3324) after a transfer: 10 seconds
+#define PSM_ACTIVE_TIME "00000101"
+
+// Requested eDRX cycle of NB-IoT: 81.92 seconds
+#define EDRX_CYCLE "0101"
+
+// Time in ms the power key has to be pulled low to wake the module
+#define POWER_KEY_PULSE 1200
+
+// Time in ms the module needs to accept commands after waking up
+#define WAKE_TIMEOUT 10000
+
+class Sim7000Modem : public Sim800Modem {
+public:
+  Sim7000Modem(Stream &serial, const __FlashStringHelper *apn,
+      const __FlashStringHelper *apnUser, const __FlashStringHelper *apnPw,
+      uint8_t powerPin);
+
+  uint8_t begin(Pt *pt);
+  uint8_t sleep(Pt *pt);
+  uint8_t wake(Pt *pt);
+
+protected:
+  void printBearer();
+  const __FlashStringHelper *registrationQuery();
+};
+
+#endif
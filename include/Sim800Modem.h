@@ -0,0 +1,67 @@
+#ifndef SIM800_MODEM_H
+#define SIM800_MODEM_H
+
+#include "Modem.h"
+
+/**
+ * Driver of the SIM800L module, uploads are sent over GPRS.
+ */
+class Sim800Modem : public Modem {
+public:
+  Sim800Modem(Stream &serial, const __FlashStringHelper *apn,
+      const __FlashStringHelper *apnUser, const __FlashStringHelper *apnPw,
+      uint8_t powerPin = NO_POWER_PIN);
+
+  uint8_t begin(Pt *pt);
+  uint8_t checkNetwork(Pt *pt);
+  uint8_t connect(Pt *pt);
+  Print &beginUrl();
+  uint8_t endUrl(Pt *pt);
+  uint8_t httpPost(Pt *pt, BodyWriter body);
+  uint8_t httpRead(Pt *pt, char *text, uint8_t size);
+  uint8_t disconnect(Pt *pt);
+  uint8_t sendSms(Pt *pt, const char *number, BodyWriter text);
+  uint8_t sendDataSms(Pt *pt, const __FlashStringHelper *number,
+      BodyWriter data, uint8_t reference, uint8_t part);
+  uint8_t readSms(Pt *pt, uint8_t index, char *number, uint8_t numberSize,
+      char *text, uint8_t textSize);
+  uint8_t udpOpen(Pt *pt, const __FlashStringHelper *host, uint16_t port);
+  uint8_t udpSend(Pt *pt, const uint8_t *data, uint8_t length);
+  int udpRead(uint8_t *buffer, uint8_t size);
+  uint8_t udpClose(Pt *pt);
+
+protected:
+
+  /**
+   * Appends the access data of the APN for the TCP/IP stack of the module to
+   * the current command line and finishes the line.
+   */
+  void printApn();
+
+  /**
+   * Writes the command line which configures the access point of the bearer.
+   */
+  virtual void printBearer();
+
+  /**
+   * @return Returns the command which asks for the registration in the
+   *         network.
+   */
+  virtual const __FlashStringHelper *registrationQuery();
+
+private:
+
+  // Number of chars of the +IPD header of a datagram matched so far
+  uint8_t ipdMatched;
+
+  // Length of the received datagram
+  uint16_t ipdLength;
+
+  // Number of bytes of the datagram received so far
+  uint16_t ipdReceived;
+
+  // The datagram itself is received
+  boolean ipdPayload;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef STATION_PROFILE_H
+#define STATION_PROFILE_H
+
+#include "Arduino.h"
+#include "Sim800Modem.h"
+#include "Sim7000Modem.h"
+#include "CoapClient.h"
+
+/**
+ * Compile-time configuration of the stations. Every station is described by a
+ * profile, which holds the hardware and the thresholds of it as constexpr
+ * members, so the compiler is able to fold them into the drivers and to leave
+ * out code of hardware which isn't installed. A profile is selected by the
+ * build flag -DSTATION_PROFILE=<profile> of its PlatformIO environment.
+ * Further profiles are derived from an existing one and only hide the
+ * members which differ.
+ */
+
+// Marker for hardware which isn't installed
+#define NO_PIN 0xFF
+
+/**
+ * Station at the Freudensee in Hauzenberg.
+ */
+struct FreudenseeProfile {
+
+  // Id of the station in the uploads, unique in the fleet
+  static constexpr uint16_t STATION_ID = 1;
+
+  /*
+   * The critical points are water levels above the datum of the gauge staff
+   * in cm, the messured distances are converted by the calibration.
+   */
+
+  // First critical point (20 cm under foodbridge)
+  static constexpr int CRIT_LEVEL_1 = 397;
+
+  // Second critical point (10 cm under foodbridge
+  static constexpr int CRIT_LEVEL_2 = 398;
+
+  // Third critical point (water entering the hut)
+  static constexpr int CRIT_LEVEL_3 = 399;
+
+  /*
+   * Margin in cm the water has to fall below a critical point before the
+   * point counts as cleared, so waves don't flap the alerts
+   */
+  static constexpr int LEVEL_HYSTERESIS = 1;
+
+  /*
+   * Level of the sensor heads above datum in cm, only used if there's no
+   * calibration stored in the EEPROM yet
+   */
+  static constexpr int SENSOR_LEVEL = 400;
+
+  // Number of installed ultra sonic modules (1 or 2)
+  static constexpr uint8_t SONAR_COUNT = 1;
+
+  // Trigger of the ultra sonic module
+  static constexpr uint8_t TRIGGER_PIN = 7;
+
+  // Echo of the ultra sonic module
+  static constexpr uint8_t ECHO_PIN = 6;
+
+  // Trigger of the second ultra sonic module
+  static constexpr uint8_t TRIGGER_PIN_2 = NO_PIN;
+
+  // Echo of the second ultra sonic module
+  static constexpr uint8_t ECHO_PIN_2 = NO_PIN;
+
+  // The maximum distance to be messured
+  static constexpr int MAX_DIST = 400;
+
+  // The minimum distance to be messured
+  static constexpr int MIN_DIST = 0;
+
+  // Analog pin of the pressure sensor on the ground of the lake
+  static constexpr uint8_t PRESSURE_PIN = NO_PIN;
+
+  // ADC value of the pressure sensor at a water depth of 0 cm
+  static constexpr int PRESSURE_ZERO_RAW = 102;
+
+  // ADC value of the pressure sensor at its full scale depth
+  static constexpr int PRESSURE_SPAN_RAW = 922;
+
+  // Full scale depth of the pressure sensor in cm
+  static constexpr int PRESSURE_SPAN_CM = 500;
+
+  // Distance from the ultra sonic sensors down to the pressure sensor in cm
+  static constexpr int PRESSURE_MOUNT_CM = 450;
+
+  // Driver of the cellular module
+  typedef Sim800Modem ModemDriver;
+
+  // TX pin of the SIM800L module
+  static constexpr uint8_t TX_PIN = 2;
+
+  // RX pin of the SIM800L module
+  static constexpr uint8_t RX_PIN = 3;
+
+  // Pin connected to the power key of the module
+  static constexpr uint8_t MODEM_POWER_PIN = NO_PIN;
+
+  // Server URL
+  static const __FlashStringHelper *serverUrl() { return F("ServerURL"); }
+
+  // Server password
+  static const __FlashStringHelper *serverPw() { return F("ServerPw"); }
+
+  // Send the uploads with CoAP over UDP instead of HTTP
+  static constexpr boolean UPLOAD_COAP = false;
+
+  // Host and port of the CoAP endpoint of the server
+  static const __FlashStringHelper *coapHost() { return F("ServerHost"); }
+  static constexpr uint16_t COAP_SERVER_PORT = COAP_PORT;
+
+  // Access data for the APN
+  static const __FlashStringHelper *apn() { return F("internet.t-mobile"); }
+  static const __FlashStringHelper *apnUser() { return F("t-mobile"); }
+  static const __FlashStringHelper *apnPw() { return F("tm"); }
+
+  // Interval in ms for trying to get valid values after getting invalid ones
+  static constexpr long INTERVAL = 1200000;
+
+  // Interval in minutes for sending data to the server
+  static constexpr uint8_t UPLOAD_PERIOD = 10;
+
+  // Interval in minutes for sending data to the server if the supply is low
+  static constexpr uint8_t UPLOAD_PERIOD_LOW = 30;
+
+  /*
+   * Highest random delay in s added to the slot of every upload, on top of
+   * the offset of the station (0 to start exactly at the slot)
+   */
+  static constexpr uint8_t UPLOAD_JITTER_S = 0;
+
+  // Delay in ms between two messurements
+  static constexpr unsigned int SAMPLE_DELAY = 500;
+
+  // Delay in ms between two messurements if the supply is low
+  static constexpr unsigned int SAMPLE_DELAY_LOW = 5000;
+
+  /*
+   * Analog pin of the battery voltage divider (without the divider Vcc is
+   * used to decide about the supply state)
+   */
+  static constexpr uint8_t BATTERY_PIN = NO_PIN;
+
+  // Ratio of the battery voltage divider (numerator / denominator)
+  static constexpr uint8_t BATTERY_DIVIDER_NUM = 2;
+  static constexpr uint8_t BATTERY_DIVIDER_DEN = 1;
+
+  // Supply voltage in mV below which the supply is low
+  static constexpr uint16_t SUPPLY_LOW_MV = 4600;
+
+  // Supply voltage in mV below which only alerts are sent
+  static constexpr uint16_t SUPPLY_CRITICAL_MV = 4300;
+
+  /*
+   * Highest allowed time in ms from the sample which crossed a critical
+   * point until the network confirmed the sms to a recipient
+   */
+  static constexpr unsigned long ALERT_SLO_MS = 60000;
+
+  // Number of sms a recipient may get in a burst (escalations don't count)
+  static constexpr uint8_t SMS_BURST = 3;
+
+  // Time in ms after which a recipient may get one more sms
+  static constexpr unsigned long SMS_REFILL_MS = 1800000;
+
+  // Number of level queries of residents answered in a burst
+  static constexpr uint8_t QUERY_BURST = 5;
+
+  /*
+   * Time in ms after which one more query is answered (3 per hour, so at most
+   * 77 answers a day are paid for)
+   */
+  static constexpr unsigned long QUERY_REFILL_MS = 1200000;
+
+  // Number of uploads after which the statistics of the module are included
+  static constexpr uint8_t AT_STATS_UPLOADS = 6;
+
+  // Number of failed uploads in a row after which the uploads are suspended
+  static constexpr uint8_t LINK_FAILURES = 3;
+
+  // Shortest and longest time in ms the uploads are suspended
+  static constexpr unsigned long LINK_BACKOFF_MIN_MS = 1200000;
+  static constexpr unsigned long LINK_BACKOFF_MAX_MS = 14400000;
+
+  /*
+   * Number of new readings after which they're sent by sms to the gateway of
+   * the server while the data connection fails (0 to never send them by sms)
+   */
+  static constexpr uint8_t DATA_SMS_READINGS = 3;
+
+  // Number of the sms gateway of the server
+  static const __FlashStringHelper *gatewayNumber() {
+    return F("GatewayNumber");
+  }
+};
+
+/**
+ * Station with two ultra sonic modules, a pressure sensor and a battery
+ * divider, which keeps messuring if single sensors fail.
+ */
+struct RedundantProfile : FreudenseeProfile {
+  static constexpr uint16_t STATION_ID = 2;
+  static constexpr uint8_t SONAR_COUNT = 2;
+  static constexpr uint8_t TRIGGER_PIN_2 = 5;
+  static constexpr uint8_t ECHO_PIN_2 = 4;
+  static constexpr uint8_t PRESSURE_PIN = A0;
+  static constexpr uint8_t BATTERY_PIN = A1;
+  static constexpr uint16_t SUPPLY_LOW_MV = 3600;
+  static constexpr uint16_t SUPPLY_CRITICAL_MV = 3400;
+};
+
+/**
+ * Station with a SIM7000 NB-IoT/LTE-M module, which stays in the power saving
+ * mode of the network between uploads.
+ */
+struct NbIotProfile : FreudenseeProfile {
+  static constexpr uint16_t STATION_ID = 3;
+  typedef Sim7000Modem ModemDriver;
+  static constexpr uint8_t MODEM_POWER_PIN = 8;
+  static const __FlashStringHelper *apn() {
+    return F("internet.nbiot.telekom.de");
+  }
+  static const __FlashStringHelper *apnUser() { return F(""); }
+  static const __FlashStringHelper *apnPw() { return F(""); }
+  static constexpr boolean UPLOAD_COAP = true;
+};
+
+#ifndef STATION_PROFILE
+#define STATION_PROFILE FreudenseeProfile
+#endif
+
+// Profile of the station this firmware is built for
+typedef STATION_PROFILE Station;
+
+static_assert(Station::STATION_ID != 0, "station id 0 is reserved");
+static_assert(Station::CRIT_LEVEL_1 < Station::CRIT_LEVEL_2
+    && Station::CRIT_LEVEL_2 < Station::CRIT_LEVEL_3,
+    "critical points have to be ascending");
+static_assert(Station::CRIT_LEVEL_3 <= Station::SENSOR_LEVEL,
+    "critical points have to be below the sensor heads");
+static_assert(Station::MIN_DIST < Station::MAX_DIST
+    && Station::MAX_DIST <= 500,
+    "distance range exceeds the range of the HC-SR04");
+static_assert(Station::SONAR_COUNT == 1 || Station::SONAR_COUNT == 2,
+    "one or two ultra sonic modules are supported");
+static_assert(Station::SONAR_COUNT == 1
+    || (Station::TRIGGER_PIN_2 != NO_PIN && Station::ECHO_PIN_2 != NO_PIN),
+    "pins of the second ultra sonic module are missing");
+static_assert(Station::TRIGGER_PIN != Station::ECHO_PIN
+    && Station::TRIGGER_PIN != Station::TX_PIN
+    && Station::TRIGGER_PIN != Station::RX_PIN
+    && Station::ECHO_PIN != Station::TX_PIN
+    && Station::ECHO_PIN != Station::RX_PIN,
+    "pins of the ultra sonic module collide");
+static_assert(Station::MODEM_POWER_PIN == NO_PIN
+    || (Station::MODEM_POWER_PIN != Station::TX_PIN
+    && Station::MODEM_POWER_PIN != Station::RX_PIN
+    && Station::MODEM_POWER_PIN != Station::TRIGGER_PIN
+    && Station::MODEM_POWER_PIN != Station::ECHO_PIN),
+    "power key of the module collides with other pins");
+static_assert(NO_PIN == NO_POWER_PIN, "markers of missing pins differ");
+static_assert(Station::PRESSURE_PIN == NO_PIN
+    || Station::PRESSURE_ZERO_RAW < Station::PRESSURE_SPAN_RAW,
+    "span of the pressure sensor is empty");
+static_assert(60 % Station::UPLOAD_PERIOD == 0
+    && 60 % Station::UPLOAD_PERIOD_LOW == 0,
+    "upload periods have to divide an hour");
+static_assert(Station::UPLOAD_JITTER_S < 60,
+    "the jitter has to stay within the minute of the slot");
+static_assert(Station::QUERY_BURST + 86400000UL / Station::QUERY_REFILL_MS
+    <= 100, "answers to queries could cost more than 100 sms a day");
+static_assert(Station::SUPPLY_CRITICAL_MV < Station::SUPPLY_LOW_MV,
+    "critical supply has to be below the low supply");
+static_assert(Station::BATTERY_DIVIDER_DEN > 0,
+    "battery divider ratio is invalid");
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef STREAM_WRITER_H
+#define STREAM_WRITER_H
+
+#include "Arduino.h"
+
+/**
+ * Streaming composition of request bodies. A body is written by a function
+ * straight from flash literals, stored records and computed fields into the
+ * given output, so it's never held in RAM. The function is run once into a
+ * CountingPrint to get the length (e.g. for AT+HTTPDATA) and once more into
+ * the transmit path of the module.
+ */
+
+/**
+ * Writes a request body to the given output. It has to write the same bytes
+ * every time it's called for the same request.
+ * @param out Given output
+ */
+typedef void (*BodyWriter)(Print &out);
+
+/**
+ * Output which only counts the bytes written to it.
+ */
+class CountingPrint : public Print {
+public:
+  CountingPrint() : count(0) {
+  }
+
+  size_t write(uint8_t) {
+    count++;
+    return 1;
+  }
+
+  size_t write(const uint8_t *, size_t size) {
+    count += size;
+    return size;
+  }
+
+  /**
+   * @return Returns the number of bytes written so far.
+   */
+  uint32_t written() const { return count; }
+
+private:
+  uint32_t count;
+};
+
+/**
+ * Output which keeps only the bytes of a window of the written stream, e.g.
+ * one block of a block-wise transfer.
+ */
+class WindowPrint : public Print {
+public:
+
+  /**
+   * @param buffer Given buffer for the bytes of the window
+   * @param offset Offset of the window in the stream
+   * @param size   Size of the window
+   */
+  WindowPrint(uint8_t *buffer, uint32_t offset, uint16_t size)
+      : buffer(buffer), offset(offset), size(size), position(0) {
+  }
+
+  size_t write(uint8_t c) {
+    if (position >= offset && position < offset + size) {
+      buffer[position - offset] = c;
+    }
+    position++;
+    return 1;
+  }
+
+  using Print::write;
+
+private:
+  uint8_t *buffer;
+  uint32_t offset;
+  uint16_t size;
+  uint32_t position;
+};
+
+/**
+ * Writes a byte as two hex digits to the given output, e.g. into a sms in
+ * PDU mode.
+ * @param out   Given output
+ * @param value Given byte
+ */
+inline void writeHex(Print &out, uint8_t value) {
+  static const char digits[] PROGMEM = "0123456789ABCDEF";
+  out.write(pgm_read_byte(digits + (value >> 4)));
+  out.write(pgm_read_byte(digits + (value & 0x0F)));
+}
+
+/**
+ * Output which writes the bytes of a window of the written stream as hex
+ * digits to another output, e.g. one part of a data sms.
+ */
+class HexWindowPrint : public Print {
+public:
+
+  /**
+   * @param out    Given output for the hex digits
+   * @param offset Offset of the window in the stream
+   * @param size   Size of the window
+   */
+  HexWindowPrint(Print &out, uint32_t offset, uint16_t size)
+      : out(out), offset(offset), size(size), position(0) {
+  }
+
+  size_t write(uint8_t c) {
+    if (position >= offset && position < offset + size) {
+      writeHex(out, c);
+    }
+    position++;
+    return 1;
+  }
+
+  using Print::write;
+
+private:
+  Print &out;
+  uint32_t offset;
+  uint16_t size;
+  uint32_t position;
+};
+
+/**
+ * Runs a given body writer to get the length of the body.
+ * @param  body Given body writer
+ * @return Returns the length of the body in bytes.
+ */
+inline uint32_t measureBody(BodyWriter body) {
+  CountingPrint counter;
+  body(counter);
+  return counter.written();
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include "Arduino.h"
+
+/**
+ * Token bucket to limit the rate of an action, e.g. the sms to one recipient.
+ * Up to capacity actions are allowed in a burst, afterwards one more action
+ * is allowed every refillMs ms.
+ */
+template<uint8_t capacity, unsigned long refillMs>
+class TokenBucket {
+  static_assert(capacity > 0, "bucket needs at least one token");
+
+public:
+  TokenBucket() : tokens(capacity), lastRefill(0) {
+  }
+
+  /**
+   * Takes a token from the bucket if there's one left.
+   * @return Returns true if the action is allowed.
+   */
+  boolean take() {
+    refill();
+    if (tokens == 0) {
+      return false;
+    }
+    tokens--;
+    return true;
+  }
+
+  /**
+   * Checks if a token is left without taking it.
+   * @return Returns true if the action would be allowed.
+   */
+  boolean available() {
+    refill();
+    return tokens > 0;
+  }
+
+private:
+
+  /**
+   * Adds the tokens which were earned since the last refill.
+   */
+  void refill() {
+    unsigned long now = millis();
+    while (tokens < capacity && now - lastRefill >= refillMs) {
+      tokens++;
+      lastRefill += refillMs;
+    }
+    if (tokens == capacity) {
+      lastRefill = now;
+    }
+  }
+
+  uint8_t tokens;
+  unsigned long lastRefill;
+};
+
+#endif
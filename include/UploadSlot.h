@@ -0,0 +1,75 @@
+#ifndef UPLOAD_SLOT_H
+#define UPLOAD_SLOT_H
+
+#include "Arduino.h"
+#include "ReadingLog.h"
+
+/**
+ * Offset of the upload slot of the station inside of the upload period, so
+ * the stations of a fleet don't hit the server and the cell all in the same
+ * second. By default the offset is spread by the id of the station, the
+ * server may assign another one in the response to an upload, which is kept
+ * in the EEPROM behind the reading log.
+ */
+
+// EEPROM address of the offset assigned by the server
+#define SLOT_ADDR (LOG_ADDR + LOG_SLOTS * sizeof(LogRecord))
+
+// Marker of an assigned offset in the EEPROM
+#define SLOT_MAGIC 0xC3
+
+// Marker for a station without an offset assigned by the server
+#define NO_SLOT 0xFFFF
+
+// Highest offset in s the server may assign (within one hour)
+#define SLOT_MAX 3599
+
+/**
+ * Offset assigned by the server as it is stored in the EEPROM.
+ */
+struct SlotAssignment {
+
+  // Offset in s from the start of the hour
+  uint16_t offset;
+
+  uint8_t magic;
+
+  // Checksum over all fields above
+  uint8_t checksum;
+};
+
+static_assert(SLOT_ADDR + sizeof(SlotAssignment) <= E2END + 1,
+    "the slot assignment doesn't fit in the EEPROM");
+
+/**
+ * Loads the offset assigned by the server from the EEPROM.
+ * @return Returns the offset in s or NO_SLOT if none was assigned.
+ */
+uint16_t loadSlotOffset();
+
+/**
+ * Stores an offset assigned by the server in the EEPROM.
+ * @param  offset Given offset in s from the start of the hour
+ * @return Returns false if the offset is invalid.
+ */
+boolean saveSlotOffset(uint16_t offset);
+
+/**
+ * Parses the response of the server to an upload, which may assign an offset
+ * as decimal number of seconds (e.g. "317").
+ * @param  text Given text of the response
+ * @return Returns the offset or NO_SLOT if the response assigns none.
+ */
+uint16_t parseSlotOffset(const char *text);
+
+/**
+ * Calculates the offset of the slot in the upload period.
+ * @param  stationId Given id of the station
+ * @param  assigned  Offset assigned by the server or NO_SLOT to spread the
+ *                   stations by their ids (Fibonacci hashing)
+ * @param  period    Given upload period in s
+ * @return Returns the offset in s (below the period).
+ */
+uint16_t slotOffset(uint16_t stationId, uint16_t assigned, uint16_t period);
+
+#endif
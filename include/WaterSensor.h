@@ -0,0 +1,339 @@
+#ifndef WATER_SENSOR_H
+#define WATER_SENSOR_H
+
+#include "Arduino.h"
+#include "FastPin.h"
+
+/**
+ * Sensor abstraction of the station. Every sensor delivers the distance from
+ * the sensor head to the water surface in mm and keeps a live health score,
+ * which is used to weight it in the fusion of all sensors. Each sensor runs a
+ * streaming anomaly detection with constant state: spikes are rejected by a
+ * robust z-score against the rolling median of the last readings, stuck
+ * values by a reading which stays the same while the fused distance of the
+ * other sensors moves and a drift by a CUSUM of the deviation from the fused
+ * distance. All of them lower the health score. A single sensor which is
+ * stuck can't be told apart from a calm lake, so it's never flagged.
+ */
+
+// Health score of a sensor which delivers valid values all the time
+#define HEALTH_MAX 100
+
+// Health score gained by a valid reading
+#define HEALTH_GAIN 10
+
+// Health score lost by an invalid reading
+#define HEALTH_LOSS 25
+
+// Health score below which a sensor is dropped from the fusion
+#define HEALTH_MIN 30
+
+// Number of valid readings in the rolling window of the anomaly detection
+#define ANOMALY_WINDOW 5
+
+// Robust z-score (in tenths) above which a reading is rejected as a spike
+#define SPIKE_Z 50
+
+// Lowest median absolute deviation in mm, so a calm surface isn't too strict
+#define SPIKE_MIN_MAD 10
+
+/*
+ * Movement in mm of the fused distance while the reading of a sensor stays
+ * the same, after which the sensor is considered stuck
+ */
+#define STUCK_MOVE 50
+
+// Slack in mm of the CUSUM against the fused distance
+#define DRIFT_SLACK 20
+
+// Cumulated deviation in mm from the fused distance which signals a drift
+#define DRIFT_LIMIT 600
+
+// Anomaly flags of a sensor
+#define ANOMALY_SPIKE 0x01
+#define ANOMALY_STUCK 0x02
+#define ANOMALY_DRIFT 0x04
+
+// Time in ms between the triggering of two sensors (avoids crosstalk)
+#define SENSOR_STAGGER 50
+
+// Marker for an invalid distance
+#define INVALID_DIST -1
+
+// Round trip time of the sound in us per cm of distance
+#define US_PER_CM 58
+
+// Resolution of the distances of the sensors in parts of a cm (mm)
+#define MM_PER_CM 10
+
+// Time in us the HC-SR04 may take to start the echo after the trigger
+#define ECHO_START_TIMEOUT 6000
+
+/**
+ * Converts the duration of an echo into the distance to the reflecting
+ * surface, so the resolution of the timing isn't rounded to whole cm.
+ * @param  echoTime Given duration of the echo in us
+ * @return Returns the distance rounded to mm.
+ */
+inline int echoToDistance(unsigned long echoTime) {
+  return (echoTime * MM_PER_CM + US_PER_CM / 2) / US_PER_CM;
+}
+
+/**
+ * Base class of all sensors which are able to messure the water heigth.
+ */
+class WaterSensor {
+public:
+  WaterSensor();
+
+  /**
+   * Takes a new reading of the sensor and updates its health score.
+   * @return Returns true if the reading is valid.
+   */
+  boolean sample() { return accept(read()); }
+
+  /**
+   * Reads the raw distance from the hardware without evaluating it, so a
+   * reading which was disturbed can be thrown away and repeated.
+   * @return Returns the distance in mm or INVALID_DIST.
+   */
+  int read() { return readDistance(); }
+
+  /**
+   * Evaluates a raw reading and updates the health score.
+   * @param  dist Given raw distance in mm or INVALID_DIST
+   * @return Returns true if the reading is valid.
+   */
+  boolean accept(int dist);
+
+  /**
+   * @return Returns the distance of the last valid reading in mm.
+   */
+  int distance() const { return lastDistance; }
+
+  /**
+   * @return Returns true if the last reading was valid.
+   */
+  boolean valid() const { return lastValid; }
+
+  /**
+   * @return Returns the current health score (0 to HEALTH_MAX).
+   */
+  uint8_t health() const { return score; }
+
+  /**
+   * @return Returns true if the sensor has to be dropped from the fusion.
+   */
+  boolean failed() const { return score < HEALTH_MIN; }
+
+  /**
+   * @return Returns the anomalies (ANOMALY_*) found since the last reset.
+   */
+  uint8_t anomalies() const { return found; }
+
+  /**
+   * Clears the anomalies found so far.
+   */
+  void resetAnomalies() { found = 0; }
+
+  /**
+   * Feeds the fused distance of all sensors into the drift detection.
+   * @param fused Fused distance in mm
+   */
+  void track(int fused);
+
+protected:
+
+  /**
+   * Reads the raw distance from the hardware.
+   * @return Returns the distance in mm or INVALID_DIST.
+   */
+  virtual int readDistance() = 0;
+
+private:
+
+  /**
+   * Checks a valid reading against the rolling window and adds it.
+   * @param  dist Distance of the reading in mm
+   * @return Returns true if the reading is a spike.
+   */
+  boolean isSpike(int dist);
+
+  // Distance of the last valid reading in mm
+  int lastDistance;
+
+  // Validity of the last reading
+  boolean lastValid;
+
+  // Live health score of the sensor
+  uint8_t score;
+
+  // Last valid readings in mm (ring buffer) and the number of them
+  int16_t window[ANOMALY_WINDOW];
+  uint8_t windowIndex;
+  uint8_t windowCount;
+
+  // Fused distance when the reading changed last or INVALID_DIST
+  int16_t frozenFused;
+
+  // The reading stays the same while the others move, until it changes
+  boolean stuck;
+
+  // CUSUM of the deviation from the fused distance upwards and downwards
+  int16_t driftHigh;
+  int16_t driftLow;
+
+  // Anomalies found since the last reset (ANOMALY_*)
+  uint8_t found;
+};
+
+/**
+ * HC-SR04 ultra sonic sensor looking down on the water surface. The trigger
+ * and echo lines are driven by FastPin, the echo is timed by polling the
+ * PINx register in a tight loop, so the edges are caught within a few cycles
+ * and the resolution is given by micros() (4 us, below 0.1 cm).
+ */
+template <uint8_t triggerPin, uint8_t echoPin>
+class UltrasonicSensor : public WaterSensor {
+public:
+  /**
+   * @param maxDist Highest valid distance in cm
+   * @param minDist Lowest valid distance in cm
+   */
+  UltrasonicSensor(int maxDist, int minDist = 0)
+      : maxDist(maxDist), minDist(minDist), initialized(false) {
+  }
+
+protected:
+  int readDistance() {
+    if (!initialized) {
+      FastPin<triggerPin>::output();
+      FastPin<echoPin>::input();
+      initialized = true;
+    }
+    unsigned long echoTime = ping();
+    if (echoTime == 0) {
+      return INVALID_DIST;
+    }
+    int dist = echoToDistance(echoTime);
+    if (dist > minDist * MM_PER_CM && dist < maxDist * MM_PER_CM) {
+      return dist;
+    }
+    return INVALID_DIST;
+  }
+
+private:
+
+  /**
+   * Triggers the module and times the echo.
+   * @return Returns the duration of the echo in us or 0 if there's no echo
+   *         within the maximum distance.
+   */
+  unsigned long ping() {
+
+    // A previous echo which is still running can't be timed
+    if (FastPin<echoPin>::read()) {
+      return 0;
+    }
+    FastPin<triggerPin>::low();
+    delayMicroseconds(4);
+    FastPin<triggerPin>::high();
+    delayMicroseconds(10);
+    FastPin<triggerPin>::low();
+
+    unsigned long start = micros();
+    while (!FastPin<echoPin>::read()) {
+      if (micros() - start > ECHO_START_TIMEOUT) {
+        return 0;
+      }
+    }
+    start = micros();
+    unsigned long timeout = (unsigned long) maxDist * US_PER_CM;
+    while (FastPin<echoPin>::read()) {
+      if (micros() - start > timeout) {
+        return 0;
+      }
+    }
+    return micros() - start;
+  }
+
+  int maxDist;
+  int minDist;
+  boolean initialized;
+};
+
+/**
+ * Analog pressure transducer lying on the ground of the lake. The depth of
+ * the water above it is converted into the distance from the ultra sonic
+ * sensor heads to the water surface, so it can be fused with them.
+ */
+class PressureSensor : public WaterSensor {
+public:
+
+  /**
+   * @param pin      Analog pin of the transducer
+   * @param zeroRaw  ADC value at a water depth of 0 cm
+   * @param spanRaw  ADC value at the full scale depth
+   * @param spanCm   Full scale depth of the transducer in cm
+   * @param mountCm  Distance from the sensor heads down to the transducer in cm
+   */
+  PressureSensor(uint8_t pin, int zeroRaw, int spanRaw, int spanCm,
+      int mountCm);
+
+protected:
+  int readDistance();
+
+private:
+  uint8_t pin;
+  int zeroRaw;
+  int spanRaw;
+  int spanCm;
+  int mountCm;
+};
+
+/**
+ * Holds a sensor only if it's installed, so the compiler leaves out the code
+ * of sensors which aren't part of the station profile.
+ */
+template <class Sensor, bool installed>
+class OptionalSensor {
+public:
+  template <typename... Args>
+  OptionalSensor(Args...) {
+  }
+
+  /**
+   * @return Returns NULL because the sensor isn't installed.
+   */
+  WaterSensor *get() { return NULL; }
+};
+
+template <class Sensor>
+class OptionalSensor<Sensor, true> {
+public:
+  template <typename... Args>
+  OptionalSensor(Args... args) : sensor(args...) {
+  }
+
+  /**
+   * @return Returns the installed sensor.
+   */
+  WaterSensor *get() { return &sensor; }
+
+private:
+  Sensor sensor;
+};
+
+/**
+ * Fuses the last readings of all given sensors to one distance, weighted by
+ * the health score of each sensor. Failed sensors are dropped from the
+ * fusion. The sensors are sampled by the caller one after another with
+ * SENSOR_STAGGER ms between them, so the loop isn't blocked while waiting.
+ * @param  sensors Given sensors (NULL for sensors which aren't installed)
+ * @param  count   Number of given sensors
+ * @return Returns the fused distance in mm or INVALID_DIST if no sensor
+ *         delivered a valid value.
+ */
+int fuseSensors(WaterSensor *sensors[], uint8_t count);
+
+#endif
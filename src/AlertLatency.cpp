@@ -0,0 +1,40 @@
+#include "AlertLatency.h"
+
+AlertLatency::AlertLatency(unsigned long sloMs)
+    : sloMs(sloMs), count(0), next(0), sloViolated(false) {
+}
+
+boolean AlertLatency::record(unsigned long crossed, unsigned long confirmed) {
+  unsigned long latency = confirmed - crossed;
+  unsigned long units = (latency + LATENCY_UNIT / 2) / LATENCY_UNIT;
+  samples[next] = units > 0xFFFF ? 0xFFFF : units;
+  next = (next + 1) % LATENCY_SAMPLES;
+  if (count < LATENCY_SAMPLES) {
+    count++;
+  }
+  if (latency > sloMs) {
+    sloViolated = true;
+    return false;
+  }
+  return true;
+}
+
+uint16_t AlertLatency::percentile(uint8_t percent) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  // Insertion sort of a copy, there are only a few latencies
+  uint16_t sorted[LATENCY_SAMPLES];
+  for (uint8_t i = 0; i < count; i++) {
+    uint16_t value = samples[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+  uint8_t rank = ((uint16_t) percent * count + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
@@ -0,0 +1,123 @@
+#include "Calibration.h"
+#include "EEPROM.h"
+
+// Fractional bits of the slope used for the interpolation
+#define SLOPE_SHIFT 8
+
+// Calibration currently in use
+static Calibration active;
+
+// Boolean if a calibration is entered point by point since the start
+static boolean entering = false;
+
+/**
+ * Calculates the checksum of a given calibration.
+ * @param  calibration Given calibration
+ * @return Returns the checksum.
+ */
+static uint8_t checksumOf(const Calibration &calibration) {
+  const uint8_t *data = (const uint8_t *) &calibration;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < offsetof(Calibration, checksum); i++) {
+    sum = (sum << 1 | sum >> 7) ^ data[i];
+  }
+  return sum;
+}
+
+/**
+ * Checks if the lookup table of a given calibration can be used.
+ * @param  calibration Given calibration
+ * @return Returns true if the table has at least two points with strictly
+ *         ascending distances.
+ */
+static boolean isValid(const Calibration &calibration) {
+  if (calibration.count < 2 || calibration.count > CALIBRATION_POINTS) {
+    return false;
+  }
+  for (uint8_t i = 1; i < calibration.count; i++) {
+    if (calibration.points[i].distance <= calibration.points[i - 1].distance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+boolean loadCalibration(int sensorLevel) {
+  EEPROM.get(CALIBRATION_ADDR, active);
+  if (active.magic == CALIBRATION_MAGIC && active.checksum == checksumOf(active)
+      && isValid(active)) {
+    return true;
+  }
+
+  // Sensor heads looking straight down from the given level
+  Calibration linear;
+  memset(&linear, 0, sizeof(linear));
+  linear.count = 2;
+  linear.points[0].distance = 0;
+  linear.points[0].level = sensorLevel;
+  linear.points[1].distance = sensorLevel;
+  linear.points[1].level = 0;
+  saveCalibration(linear);
+  return false;
+}
+
+boolean saveCalibration(Calibration &calibration) {
+  if (!isValid(calibration)) {
+    return false;
+  }
+  calibration.magic = CALIBRATION_MAGIC;
+  calibration.checksum = checksumOf(calibration);
+  EEPROM.put(CALIBRATION_ADDR, calibration);
+  active = calibration;
+  return true;
+}
+
+void beginCalibration(int mountOffset) {
+  Calibration calibration;
+  memset(&calibration, 0, sizeof(calibration));
+  calibration.mountOffset = mountOffset;
+  EEPROM.put(CALIBRATION_ADDR, calibration);
+  entering = true;
+}
+
+boolean addCalibrationPoint(int distance, int level) {
+  Calibration calibration;
+  if (!entering) {
+    return false;
+  }
+  EEPROM.get(CALIBRATION_ADDR, calibration);
+  if (calibration.count >= CALIBRATION_POINTS || (calibration.count > 0
+      && distance <= calibration.points[calibration.count - 1].distance)) {
+    return false;
+  }
+  calibration.points[calibration.count].distance = distance;
+  calibration.points[calibration.count].level = level;
+  calibration.count++;
+  if (isValid(calibration)) {
+    return saveCalibration(calibration);
+  }
+
+  // A single point isn't used yet
+  EEPROM.put(CALIBRATION_ADDR, calibration);
+  return true;
+}
+
+int distanceToLevel(int distance) {
+  int corrected = distance + active.mountOffset;
+
+  // Find the segment of the table, the outer ones are extrapolated
+  uint8_t i = 1;
+  while (i < active.count - 1 && corrected > active.points[i].distance) {
+    i++;
+  }
+  const CalibrationPoint &lower = active.points[i - 1];
+  const CalibrationPoint &upper = active.points[i];
+
+  long slope = ((long) (upper.level - lower.level) << SLOPE_SHIFT)
+      / (upper.distance - lower.distance);
+  long delta = (long) (corrected - lower.distance) * slope;
+
+  // Round to the nearest cm
+  delta += delta < 0 ? -(1L << (SLOPE_SHIFT - 1)) : (1L << (SLOPE_SHIFT - 1));
+  return lower.level + (int) (delta / (1L << SLOPE_SHIFT));
+}
@@ -0,0 +1,187 @@
+#include "CoapClient.h"
+
+// Version 1 and type confirmable in the first byte of the header
+#define COAP_CON 0x40
+
+// Type acknowledgement
+#define COAP_ACK 0x20
+
+// Mask of the type in the first byte of the header
+#define COAP_TYPE_MASK 0x30
+
+// Code of a POST request
+#define COAP_POST 0x02
+
+// Numbers of the used options
+#define OPTION_URI_PATH 11
+#define OPTION_CONTENT_FORMAT 12
+#define OPTION_MAX_AGE 14
+#define OPTION_BLOCK1 27
+
+// Content format application/octet-stream
+#define CONTENT_OCTET_STREAM 42
+
+// Marker between the options and the payload
+#define PAYLOAD_MARKER 0xFF
+
+// Length of the token of the requests
+#define TOKEN_LENGTH 2
+
+/**
+ * Writes the header of an option.
+ * @param  buffer Given buffer
+ * @param  delta  Difference to the number of the previous option
+ * @param  length Length of the value of the option (below 13)
+ * @return Returns the number of written bytes.
+ */
+static uint8_t writeOption(uint8_t *buffer, uint8_t delta, uint8_t length) {
+  if (delta < 13) {
+    buffer[0] = delta << 4 | length;
+    return 1;
+  }
+  buffer[0] = 13 << 4 | length;
+  buffer[1] = delta - 13;
+  return 2;
+}
+
+CoapClient::CoapClient(Modem &modem)
+    : modem(modem), messageId(0), byteCount(0),
+      roundTripCount(0), messageLength(0), token(0), length(0), offset(0),
+      block(0), size(0), more(false), attempt(0), start(0), timeout(0),
+      code(-1), age(COAP_MAX_AGE), payloadStart(0), payloadLength(0) {
+  PT_INIT(&send);
+}
+
+void CoapClient::begin() {
+  messageId = random(0x10000);
+}
+
+boolean CoapClient::receiveAck() {
+  int received = udpRead(ack, COAP_ACK_SIZE);
+  if (received < 4) {
+    return false;
+  }
+  byteCount += received;
+
+  // A truncated acknowledgement would lose options or payload
+  if (received > COAP_ACK_SIZE) {
+    return false;
+  }
+
+  // Only the acknowledgement of this message is of interest
+  if ((ack[0] & COAP_TYPE_MASK) != COAP_ACK || ack[2] != message[2]
+      || ack[3] != message[3]) {
+    return false;
+  }
+  code = (ack[1] >> 5) * 100 + (ack[1] & 0x1F);
+
+  // Walk the options for the Max-Age, longer options aren't of interest
+  age = COAP_MAX_AGE;
+  payloadLength = 0;
+  uint8_t n = 4 + (ack[0] & 0x0F);
+  uint16_t number = 0;
+  while (n < received && ack[n] != PAYLOAD_MARKER) {
+    uint16_t delta = ack[n] >> 4;
+    uint8_t optionLength = ack[n++] & 0x0F;
+    if (delta == 13 && n < received) {
+      delta = 13 + ack[n++];
+    } else if (delta >= 13 || optionLength >= 13) {
+      break;
+    }
+    number += delta;
+    if (n + optionLength > received) {
+      break;
+    }
+    if (number == OPTION_MAX_AGE && optionLength <= 4) {
+      age = 0;
+      for (uint8_t i = 0; i < optionLength; i++) {
+        age = age << 8 | ack[n + i];
+      }
+    }
+    n += optionLength;
+  }
+  if (n < received && ack[n] == PAYLOAD_MARKER) {
+    payloadStart = n + 1;
+    payloadLength = received - payloadStart;
+  }
+  return true;
+}
+
+void CoapClient::responseText(char *text, uint8_t size) const {
+  uint8_t length = min(payloadLength, size - 1);
+  memcpy(text, ack + payloadStart, length);
+  text[length] = '\0';
+}
+
+void CoapClient::buildMessage(const char *path, BodyWriter body) {
+  uint8_t pathLength = strlen(path);
+  size = length - offset > COAP_BLOCK_SIZE ? COAP_BLOCK_SIZE : length - offset;
+  more = offset + size < length;
+  messageId++;
+  uint8_t n = 0;
+  message[n++] = COAP_CON | TOKEN_LENGTH;
+  message[n++] = COAP_POST;
+  message[n++] = messageId >> 8;
+  message[n++] = messageId;
+  message[n++] = token >> 8;
+  message[n++] = token;
+
+  // Options in ascending order of their numbers
+  n += writeOption(message + n, OPTION_URI_PATH, pathLength);
+  memcpy(message + n, path, pathLength);
+  n += pathLength;
+  n += writeOption(message + n, OPTION_CONTENT_FORMAT - OPTION_URI_PATH, 1);
+  message[n++] = CONTENT_OCTET_STREAM;
+  if (length > COAP_BLOCK_SIZE) {
+    uint16_t value = (uint16_t) block << 4 | (more ? 0x08 : 0)
+        | COAP_BLOCK_SZX;
+    uint8_t delta = OPTION_BLOCK1 - OPTION_CONTENT_FORMAT;
+    if (value > 0xFF) {
+      n += writeOption(message + n, delta, 2);
+      message[n++] = value >> 8;
+    } else {
+      n += writeOption(message + n, delta, 1);
+    }
+    message[n++] = value;
+  }
+  message[n++] = PAYLOAD_MARKER;
+  WindowPrint window(message + n, offset, size);
+  body(window);
+  messageLength = n + size;
+}
+
+uint8_t CoapClient::post(Pt *pt, const char *path, BodyWriter body) {
+  PT_BEGIN(pt);
+  length = measureBody(body);
+  token = random(0x10000);
+  offset = 0;
+  block = 0;
+  code = -1;
+  if (strlen(path) > COAP_MAX_PATH || length > 0xFFFUL * COAP_BLOCK_SIZE) {
+    PT_EXIT(pt);
+  }
+  do {
+    buildMessage(path, body);
+
+    // Retransmissions with exponential backoff until the acknowledgement
+    code = -1;
+    timeout = COAP_ACK_TIMEOUT + random(COAP_ACK_TIMEOUT / 2);
+    for (attempt = 0; attempt <= COAP_MAX_RETRANSMIT && code == -1;
+        attempt++) {
+      roundTripCount++;
+      PT_SPAWN(pt, &send, udpSend(&send, message, messageLength));
+      if (modem.result()) {
+        byteCount += messageLength;
+      }
+      start = millis();
+      PT_WAIT_UNTIL(pt, receiveAck() || millis() - start >= timeout);
+      timeout *= 2;
+    }
+    if (more && code != COAP_CONTINUE) {
+      PT_EXIT(pt);
+    }
+    offset += size;
+    block++;
+  } while (offset < length);
+  PT_END(pt);
+}
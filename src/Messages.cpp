@@ -0,0 +1,106 @@
+#include "Messages.h"
+
+/*
+ * Letters of the GSM 03.38 default alphabet which differ from ASCII. They're
+ * separate literals, so the hex escape ends before the following letters.
+ */
+#define GSM_AE "\x5B"
+#define GSM_OE "\x5C"
+#define GSM_UE "\x5E"
+#define GSM_ae "\x7B"
+#define GSM_oe "\x7C"
+#define GSM_ue "\x7E"
+#define GSM_ss "\x1E"
+
+// German titles
+static const char deLevel[] PROGMEM = "";
+static const char deReached1[] PROGMEM = "Meldestufe 1 erreicht!!!";
+static const char deReached2[] PROGMEM = "Meldestufe 2 erreicht!!!";
+static const char deReached3[] PROGMEM =
+    "Wir saufen ab!!! Meldestufe 3 erreicht!!!";
+static const char deCleared1[] PROGMEM = "Meldestufe 1 aufgehoben!!!";
+static const char deCleared2[] PROGMEM = "Meldestufe 2 aufgehoben!!!";
+static const char deCleared3[] PROGMEM = "Meldestufe 3 aufgehoben!!!";
+static const char deSensor[] PROGMEM =
+    "Fehler mit dem Ultraschallsensor bitte " GSM_UE "berpr" GSM_ue "fen!";
+static const char deRtc[] PROGMEM =
+    "Fehler mit dem RTC-Modul bitte " GSM_ue "berpr" GSM_ue "fen!";
+
+// English titles
+static const char enLevel[] PROGMEM = "";
+static const char enReached1[] PROGMEM = "Alert level 1 reached!!!";
+static const char enReached2[] PROGMEM = "Alert level 2 reached!!!";
+static const char enReached3[] PROGMEM =
+    "Alert level 3 reached!!! Water is entering the hut!!!";
+static const char enCleared1[] PROGMEM = "Alert level 1 cleared!!!";
+static const char enCleared2[] PROGMEM = "Alert level 2 cleared!!!";
+static const char enCleared3[] PROGMEM = "Alert level 3 cleared!!!";
+static const char enSensor[] PROGMEM =
+    "Failure of the ultrasonic sensor, please check!";
+static const char enRtc[] PROGMEM = "Failure of the RTC module, please check!";
+
+// Titles of all messages per language
+static const char *const titles[LANGUAGE_COUNT][MESSAGE_COUNT] PROGMEM = {
+  { deLevel, deReached1, deReached2, deReached3, deCleared1, deCleared2,
+    deCleared3, deSensor, deRtc },
+  { enLevel, enReached1, enReached2, enReached3, enCleared1, enCleared2,
+    enCleared3, enSensor, enRtc }
+};
+
+// Label of the water level per language
+static const char deLevelLabel[] PROGMEM = "Wasserstand: ";
+static const char enLevelLabel[] PROGMEM = "Water level: ";
+static const char *const levelLabels[LANGUAGE_COUNT] PROGMEM = {
+  deLevelLabel, enLevelLabel
+};
+
+// Keyword of a query for the current level per language
+static const char deQuery[] PROGMEM = "PEGEL";
+static const char enQuery[] PROGMEM = "LEVEL";
+static const char *const queries[LANGUAGE_COUNT] PROGMEM = {
+  deQuery, enQuery
+};
+
+/**
+ * Writes a text from flash to the given output.
+ * @param out  Given output
+ * @param text Given text in flash
+ */
+static void writeFlash(Print &out, const char *text) {
+  out.print(reinterpret_cast<const __FlashStringHelper *>(text));
+}
+
+void writeMessage(Print &out, MessageCode code, Language language, int level) {
+  if (code >= MESSAGE_COUNT) {
+    return;
+  }
+  if (language >= LANGUAGE_COUNT) {
+    language = LANG_DE;
+  }
+  const char *title = (const char *) pgm_read_ptr(&titles[language][code]);
+  writeFlash(out, title);
+  if (code == MSG_SENSOR_FAILURE || code == MSG_RTC_FAILURE) {
+    return;
+  }
+  if (pgm_read_byte(title) != '\0') {
+    out.print('\n');
+  }
+  writeFlash(out, (const char *) pgm_read_ptr(&levelLabels[language]));
+  out.print(level);
+  out.print(F(" cm"));
+}
+
+int parseQuery(const char *text) {
+  while (*text == ' ' || *text == '\n') {
+    text++;
+  }
+  for (uint8_t language = 0; language < LANGUAGE_COUNT; language++) {
+    const char *keyword = (const char *) pgm_read_ptr(&queries[language]);
+    size_t length = strlen_P(keyword);
+    if (strncasecmp_P(text, keyword, length) == 0
+        && (text[length] == '\0' || text[length] == ' ')) {
+      return language;
+    }
+  }
+  return NO_QUERY;
+}
@@ -0,0 +1,183 @@
+#include "Modem.h"
+
+const char atOk[] PROGMEM = "OK";
+
+Modem::Modem(Stream &serial, const __FlashStringHelper *apn,
+    const __FlashStringHelper *apnUser, const __FlashStringHelper *apnPw,
+    uint8_t powerPin)
+    : serial(serial), apn(apn), apnUser(apnUser), apnPw(apnPw),
+      powerPin(powerPin), timer(0), expected(atOk), start(0), timeout(0),
+      length(0), state(AT_OK), lastResult(0), lineCount(0), lastReference(0),
+      contentLength(0), reportCount(0), incomingCount(0),
+      currentStep(AT_STEP_CONTROL) {
+  line[0] = '\0';
+  memset(stepStats, 0, sizeof(stepStats));
+}
+
+uint8_t Modem::sleep(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_CONTROL);
+  finish(true);
+  PT_END(pt);
+}
+
+uint8_t Modem::wake(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_CONTROL);
+  finish(true);
+  PT_END(pt);
+}
+
+void Modem::idle() {
+  if (state == AT_PENDING) {
+    return;
+  }
+  while (readLine()) {
+  }
+}
+
+boolean Modem::nextStatusReport(StatusReport &report) {
+  if (reportCount == 0) {
+    return false;
+  }
+  report = reports[0];
+  memmove(reports, reports + 1, --reportCount * sizeof(StatusReport));
+  return true;
+}
+
+boolean Modem::nextIncomingSms(uint8_t &index) {
+  if (incomingCount == 0) {
+    return false;
+  }
+  index = incoming[0];
+  memmove(incoming, incoming + 1, --incomingCount);
+  return true;
+}
+
+void Modem::sendCommand(const __FlashStringHelper *cmd, PGM_P expect,
+    unsigned long timeout) {
+  beginCommand();
+  serial.println(cmd);
+  this->expect(expect, timeout);
+}
+
+void Modem::expect(PGM_P expect, unsigned long timeout) {
+  expected = expect;
+  this->timeout = timeout;
+  start = millis();
+  length = 0;
+  line[0] = '\0';
+  state = AT_PENDING;
+}
+
+boolean Modem::readLine() {
+  while (serial.available()) {
+    char c = serial.read();
+    Serial.write(c);
+    if (c == '\r') {
+      continue;
+    }
+
+    // Prompts of the module aren't terminated by a new line
+    boolean prompt = c == '>' && length == 0;
+    if (prompt || c == '\n') {
+      if (prompt) {
+        line[length++] = c;
+      }
+      line[length] = '\0';
+      if (length == 0) {
+        continue;
+      }
+      length = 0;
+      if (strncmp_P(line, PSTR("+CDS:"), 5) == 0) {
+        keepStatusReport();
+        continue;
+      }
+      if (strncmp_P(line, PSTR("+CMTI:"), 6) == 0) {
+        keepIncomingSms();
+        continue;
+      }
+      return true;
+    }
+    if (length < AT_LINE_SIZE - 1) {
+      line[length++] = c;
+    }
+  }
+  return false;
+}
+
+void Modem::keepStatusReport() {
+  char *reference = strchr(line, ',');
+  char *status = strrchr(line, ',');
+  if (reference == NULL || status == reference) {
+    return;
+  }
+  if (reportCount == STATUS_REPORT_QUEUE) {
+
+    // Drop the oldest report, its sms is treated as unconfirmed
+    memmove(reports, reports + 1, --reportCount * sizeof(StatusReport));
+  }
+  StatusReport &report = reports[reportCount++];
+  report.reference = atoi(reference + 1);
+  report.status = atoi(status + 1);
+}
+
+void Modem::keepIncomingSms() {
+  char *index = strchr(line, ',');
+  if (index == NULL) {
+    return;
+  }
+  if (incomingCount == INCOMING_SMS_QUEUE) {
+
+    // Drop the oldest indication, its sms stays in the storage unread
+    memmove(incoming, incoming + 1, --incomingCount);
+  }
+  incoming[incomingCount++] = atoi(index + 1);
+}
+
+AtResponse Modem::poll() {
+  if (state != AT_PENDING) {
+    return state;
+  }
+  while (readLine()) {
+    if (strstr_P(line, expected) != NULL) {
+      return settle(AT_OK);
+    }
+    if (strstr_P(line, PSTR("ERROR")) != NULL) {
+      return settle(AT_ERROR);
+    }
+  }
+  if (millis() - start >= timeout) {
+    line[length] = '\0';
+    return settle(AT_TIMED_OUT);
+  }
+  return AT_PENDING;
+}
+
+AtResponse Modem::settle(AtResponse response) {
+  AtStats &stats = stepStats[currentStep];
+  if (response == AT_ERROR) {
+    stats.errors++;
+  } else if (response == AT_TIMED_OUT) {
+    stats.timeouts++;
+  } else {
+    unsigned long latency = millis() - start;
+    uint8_t bucket = 0;
+    for (unsigned long bound = AT_LATENCY_FIRST;
+        latency >= bound && bucket < AT_LATENCY_BUCKETS - 1; bound <<= 1) {
+      bucket++;
+    }
+    stats.latency[bucket]++;
+  }
+  return state = response;
+}
+
+void Modem::beginCommand() {
+  flush();
+  lineCount++;
+}
+
+void Modem::flush() {
+  while (readLine()) {
+  }
+}
@@ -0,0 +1,97 @@
+#include "Payload.h"
+
+void encodeBatchHeader(uint8_t *buffer, uint16_t stationId,
+    uint16_t sequence, uint8_t count) {
+  buffer[0] = PAYLOAD_VERSION;
+  buffer[1] = stationId >> 8;
+  buffer[2] = stationId;
+  buffer[3] = sequence >> 8;
+  buffer[4] = sequence;
+  buffer[5] = count;
+}
+
+void encodeReading(uint8_t *buffer, const Reading &reading) {
+  buffer[0] = reading.time >> 24;
+  buffer[1] = reading.time >> 16;
+  buffer[2] = reading.time >> 8;
+  buffer[3] = reading.time;
+  buffer[4] = reading.level >> 8;
+  buffer[5] = reading.level;
+  buffer[6] = reading.vcc >> 8;
+  buffer[7] = reading.vcc;
+  buffer[8] = reading.vmin >> 8;
+  buffer[9] = reading.vmin;
+  buffer[10] = reading.vmax >> 8;
+  buffer[11] = reading.vmax;
+  buffer[12] = reading.temperature;
+  buffer[13] = reading.diagnostics;
+  buffer[14] = reading.alertP50 >> 8;
+  buffer[15] = reading.alertP50;
+  buffer[16] = reading.alertP95 >> 8;
+  buffer[17] = reading.alertP95;
+}
+
+void encodeDeliveryStats(uint8_t *buffer, const DeliveryStats &stats) {
+  buffer[0] = stats.delivered;
+  buffer[1] = stats.failed;
+  buffer[2] = stats.unconfirmed;
+  buffer[3] = stats.latency >> 8;
+  buffer[4] = stats.latency;
+}
+
+void encodeAtStats(uint8_t *buffer, const AtStats &stats) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < AT_LATENCY_BUCKETS; i++) {
+    buffer[n++] = stats.latency[i] >> 8;
+    buffer[n++] = stats.latency[i];
+  }
+  buffer[n++] = stats.errors >> 8;
+  buffer[n++] = stats.errors;
+  buffer[n++] = stats.timeouts >> 8;
+  buffer[n++] = stats.timeouts;
+}
+
+void encodeLinkStats(uint8_t *buffer, const LinkStats &stats) {
+  buffer[0] = stats.failures >> 8;
+  buffer[1] = stats.failures;
+  buffer[2] = stats.wastedSeconds >> 8;
+  buffer[3] = stats.wastedSeconds;
+}
+
+void writeBatchHeader(Print &out, uint16_t stationId, uint16_t sequence,
+    uint8_t count) {
+  uint8_t buffer[BATCH_HEADER_SIZE];
+  encodeBatchHeader(buffer, stationId, sequence, count);
+  out.write(buffer, BATCH_HEADER_SIZE);
+}
+
+void writeReading(Print &out, const Reading &reading) {
+  uint8_t buffer[READING_SIZE];
+  encodeReading(buffer, reading);
+  out.write(buffer, READING_SIZE);
+}
+
+void writeDeliveryStats(Print &out, const DeliveryStats stats[],
+    uint8_t count) {
+  uint8_t buffer[DELIVERY_STATS_SIZE];
+  out.write(count);
+  for (uint8_t i = 0; i < count; i++) {
+    encodeDeliveryStats(buffer, stats[i]);
+    out.write(buffer, DELIVERY_STATS_SIZE);
+  }
+}
+
+void writeAtStats(Print &out, const AtStats stats[], uint8_t count) {
+  uint8_t buffer[AT_STATS_SIZE];
+  out.write(count);
+  for (uint8_t i = 0; i < count; i++) {
+    encodeAtStats(buffer, stats[i]);
+    out.write(buffer, AT_STATS_SIZE);
+  }
+}
+
+void writeLinkStats(Print &out, const LinkStats &stats) {
+  uint8_t buffer[LINK_STATS_SIZE];
+  encodeLinkStats(buffer, stats);
+  out.write(buffer, LINK_STATS_SIZE);
+}
@@ -0,0 +1,80 @@
+#include "PowerMonitor.h"
+
+PowerMonitor::PowerMonitor(uint16_t lowMv, uint16_t criticalMv,
+    uint8_t batteryPin, uint8_t dividerNum, uint8_t dividerDen)
+    : lowMv(lowMv), criticalMv(criticalMv), batteryPin(batteryPin),
+      dividerNum(dividerNum), dividerDen(dividerDen), lastVcc(0),
+      lastBattery(0), currentState(POWER_NORMAL), worseSamples(0) {
+  resetTrend();
+}
+
+uint16_t PowerMonitor::readVcc() {
+
+  // AVcc as reference, bandgap as input
+  ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+
+  // Let the bandgap settle
+  delay(2);
+  ADCSRA |= _BV(ADSC);
+  while (bit_is_set(ADCSRA, ADSC));
+  uint16_t raw = ADC;
+  if (raw == 0) {
+    return 0;
+  }
+  return BANDGAP_MV * 1023 / raw;
+}
+
+void PowerMonitor::sample() {
+  lastVcc = readVcc();
+  lastBattery = lastVcc;
+  if (batteryPin != NO_BATTERY_PIN) {
+    long raw = analogRead(batteryPin);
+    lastBattery = raw * lastVcc * dividerNum / (1023L * dividerDen);
+  }
+
+  // Leave a worse state only if the voltage recovered by the hysteresis
+  uint16_t mv = lastBattery;
+  PowerState next = currentState;
+  if (mv < criticalMv) {
+    next = POWER_CRITICAL;
+  } else if (mv < lowMv) {
+    if (currentState != POWER_CRITICAL || mv >= criticalMv + POWER_HYSTERESIS) {
+      next = POWER_LOW;
+    }
+  } else if (currentState == POWER_NORMAL || mv >= lowMv + POWER_HYSTERESIS) {
+    next = POWER_NORMAL;
+  } else if (currentState == POWER_CRITICAL
+      && mv >= criticalMv + POWER_HYSTERESIS) {
+    next = POWER_LOW;
+  }
+
+  // A worse state has to be confirmed by the following samples
+  if (next > currentState && ++worseSamples < POWER_CONFIRM) {
+    next = currentState;
+  } else {
+    worseSamples = 0;
+  }
+  currentState = next;
+
+  if (mv < minMv) {
+    minMv = mv;
+  }
+  if (mv > maxMv) {
+    maxMv = mv;
+  }
+  if (samples < 0xFFFF) {
+    sumMv += mv;
+    samples++;
+  }
+}
+
+uint16_t PowerMonitor::trendAvg() const {
+  return samples == 0 ? 0 : sumMv / samples;
+}
+
+void PowerMonitor::resetTrend() {
+  minMv = 0xFFFF;
+  maxMv = 0;
+  sumMv = 0;
+  samples = 0;
+}
@@ -0,0 +1,99 @@
+#include "ReadingLog.h"
+#include "EEPROM.h"
+
+/**
+ * Calculates the EEPROM address of a given slot.
+ * @param  slot Given slot
+ * @return Returns the address of the record in the slot.
+ */
+static int addressOf(uint8_t slot) {
+  return LOG_ADDR + slot * sizeof(LogRecord);
+}
+
+/**
+ * Calculates the checksum of a given record.
+ * @param  record Given record
+ * @return Returns the checksum.
+ */
+static uint8_t checksumOf(const LogRecord &record) {
+  uint8_t sum = record.sequence >> 8;
+  sum = (sum << 1 | sum >> 7) ^ (uint8_t) record.sequence;
+  for (uint8_t i = 0; i < READING_SIZE; i++) {
+    sum = (sum << 1 | sum >> 7) ^ record.reading[i];
+  }
+  return sum;
+}
+
+/**
+ * Loads a record from the EEPROM.
+ * @param  slot   Given slot
+ * @param  record Loaded record
+ * @return Returns false if the slot holds no complete record.
+ */
+static boolean loadRecord(uint8_t slot, LogRecord &record) {
+  EEPROM.get(addressOf(slot), record);
+  return (record.state == LOG_PENDING || record.state == LOG_ACKED)
+      && record.checksum == checksumOf(record);
+}
+
+ReadingLog::ReadingLog() : head(0), count(0), sequence(0) {
+}
+
+void ReadingLog::recover() {
+  LogRecord record;
+  boolean found = false;
+  head = 0;
+  count = 0;
+  sequence = 0;
+
+  // The newest record is the one with the highest sequence number
+  for (uint8_t slot = 0; slot < LOG_SLOTS; slot++) {
+    if (loadRecord(slot, record)
+        && (!found || (int16_t) (record.sequence - sequence) >= 0)) {
+      sequence = record.sequence + 1;
+      head = (slot + 1) % LOG_SLOTS;
+      found = true;
+    }
+  }
+
+  // Pending records are the unbroken run of sequence numbers before it
+  while (count < LOG_SLOTS) {
+    uint8_t slot = (head + LOG_SLOTS - count - 1) % LOG_SLOTS;
+    if (!loadRecord(slot, record) || record.state != LOG_PENDING
+        || record.sequence != (uint16_t) (sequence - count - 1)) {
+      break;
+    }
+    count++;
+  }
+}
+
+void ReadingLog::append(const Reading &reading) {
+  LogRecord record;
+  record.sequence = sequence++;
+  record.state = LOG_PENDING;
+  encodeReading(record.reading, reading);
+  record.checksum = checksumOf(record);
+  EEPROM.put(addressOf(head), record);
+  head = (head + 1) % LOG_SLOTS;
+  if (count < LOG_SLOTS) {
+    count++;
+  }
+}
+
+void ReadingLog::write(Print &out, uint8_t number, uint8_t skip) const {
+  for (uint8_t i = skip; i < skip + number && i < count; i++) {
+    uint8_t slot = (head + LOG_SLOTS - count + i) % LOG_SLOTS;
+    int address = addressOf(slot) + offsetof(LogRecord, reading);
+    for (uint8_t j = 0; j < READING_SIZE; j++) {
+      out.write(EEPROM.read(address + j));
+    }
+  }
+}
+
+void ReadingLog::acknowledge(uint8_t number) {
+  for (; number > 0 && count > 0; number--) {
+    uint8_t slot = (head + LOG_SLOTS - count) % LOG_SLOTS;
+    EEPROM.update(addressOf(slot) + offsetof(LogRecord, state), LOG_ACKED);
+    count--;
+  }
+}
@@ -0,0 +1,69 @@
+#include "Recipients.h"
+#include "EEPROM.h"
+
+/**
+ * Calculates the checksum of a given entry.
+ * @param  recipient Given entry
+ * @return Returns the checksum.
+ */
+static uint8_t checksumOf(const Recipient &recipient) {
+  const uint8_t *data = (const uint8_t *) &recipient;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < offsetof(Recipient, checksum); i++) {
+    sum = (sum << 1 | sum >> 7) ^ data[i];
+  }
+  return sum;
+}
+
+/**
+ * Checks if a given entry can be used.
+ * @param  recipient Given entry
+ * @return Returns true if the number is terminated and not empty and the
+ *         language is known.
+ */
+static boolean isValid(const Recipient &recipient) {
+  return recipient.number[0] != '\0'
+      && memchr(recipient.number, '\0', NUMBER_SIZE) != NULL
+      && recipient.language < LANGUAGE_COUNT;
+}
+
+boolean loadRecipient(uint8_t index, Recipient &recipient) {
+  if (index >= RECIPIENT_COUNT) {
+    return false;
+  }
+  EEPROM.get(RECIPIENT_ADDR + index * sizeof(Recipient), recipient);
+  return recipient.magic == RECIPIENT_MAGIC
+      && recipient.checksum == checksumOf(recipient) && isValid(recipient);
+}
+
+boolean saveRecipient(uint8_t index, Recipient &recipient) {
+  if (index >= RECIPIENT_COUNT || !isValid(recipient)) {
+    return false;
+  }
+  recipient.magic = RECIPIENT_MAGIC;
+  recipient.checksum = checksumOf(recipient);
+  EEPROM.put(RECIPIENT_ADDR + index * sizeof(Recipient), recipient);
+  return true;
+}
+
+boolean removeRecipient(uint8_t index) {
+  if (index >= RECIPIENT_COUNT) {
+    return false;
+  }
+  EEPROM.update(RECIPIENT_ADDR + index * sizeof(Recipient), 0);
+  return true;
+}
+
+boolean isReplyNumber(const char *number) {
+  if (*number == '+') {
+    number++;
+  }
+  uint8_t digits = 0;
+  for (; *number != '\0'; number++) {
+    if (*number < '0' || *number > '9') {
+      return false;
+    }
+    digits++;
+  }
+  return digits >= NUMBER_MIN_DIGITS;
+}
@@ -0,0 +1,88 @@
+#include "RtcService.h"
+#include "Wire.h"
+
+// Register of the seconds, the first one read
+#define REG_SECONDS 0x00
+
+// Register of the status, containing the oscillator stop flag
+#define REG_STATUS 0x0F
+
+// Register of the temperature MSB, the last one read
+#define REG_TEMP_MSB 0x11
+
+// Number of registers read in one transaction
+#define REG_COUNT (REG_TEMP_MSB - REG_SECONDS + 2)
+
+// Oscillator stop flag in the status register
+#define STATUS_OSF 0x80
+
+/**
+ * Converts a given BCD value to binary.
+ * @param  value Given BCD value
+ * @return Returns the binary value.
+ */
+static uint8_t bcd2bin(uint8_t value) {
+  return value - 6 * (value >> 4);
+}
+
+RtcService::RtcService()
+    : syncTime(0), syncMillis(0), slotPeriod(0), slotOffset(0),
+      oscillatorStopped(false),
+      quarterDegrees(0), transactionCount(0) {
+}
+
+boolean RtcService::begin() {
+  Wire.begin();
+  Wire.setClock(I2C_CLOCK);
+  return sync();
+}
+
+boolean RtcService::sync() {
+  uint8_t regs[REG_COUNT];
+  transactionCount++;
+  Wire.beginTransmission(DS3231_ADDRESS);
+  Wire.write((uint8_t) REG_SECONDS);
+  if (Wire.endTransmission(false) != 0
+      || Wire.requestFrom((uint8_t) DS3231_ADDRESS, (uint8_t) REG_COUNT)
+          != REG_COUNT) {
+    return false;
+  }
+  for (uint8_t i = 0; i < REG_COUNT; i++) {
+    regs[i] = Wire.read();
+  }
+  syncMillis = millis();
+
+  // Hours are either stored in 24 hour or in 12 hour mode with a PM bit
+  uint8_t hourReg = regs[2];
+  uint8_t hour;
+  if (hourReg & 0x40) {
+    hour = bcd2bin(hourReg & 0x1F) % 12 + ((hourReg & 0x20) ? 12 : 0);
+  } else {
+    hour = bcd2bin(hourReg & 0x3F);
+  }
+  DateTime time(2000 + bcd2bin(regs[6]), bcd2bin(regs[5] & 0x1F),
+      bcd2bin(regs[4]), hour, bcd2bin(regs[1]), bcd2bin(regs[0] & 0x7F));
+  syncTime = time.unixtime();
+
+  oscillatorStopped = (regs[REG_STATUS] & STATUS_OSF) != 0;
+  quarterDegrees = ((int16_t) (int8_t) regs[REG_TEMP_MSB] << 2)
+      | (regs[REG_TEMP_MSB + 1] >> 6);
+  return true;
+}
+
+DateTime RtcService::now() {
+  unsigned long elapsed = millis() - syncMillis;
+  uint32_t extrapolated = syncTime + elapsed / 1000;
+  boolean resync = elapsed >= RTC_RESYNC;
+
+  // Read the module again shortly before a slot, so it starts on time
+  if (slotPeriod > 0 && elapsed >= RTC_SLOT_GUARD * 1000L) {
+    uint16_t period = slotPeriod * 60;
+    uint16_t untilSlot = period - (extrapolated - slotOffset) % period;
+    resync = resync || untilSlot <= RTC_SLOT_GUARD;
+  }
+  if (resync && sync()) {
+    return DateTime(syncTime);
+  }
+  return DateTime(extrapolated);
+}
@@ -0,0 +1,83 @@
+#include "Sim7000Modem.h"
+
+Sim7000Modem::Sim7000Modem(Stream &serial, const __FlashStringHelper *apn,
+    const __FlashStringHelper *apnUser, const __FlashStringHelper *apnPw,
+    uint8_t powerPin)
+    : Sim800Modem(serial, apn, apnUser, apnPw, powerPin) {
+}
+
+uint8_t Sim7000Modem::begin(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_CONTROL);
+  if (powerPin != NO_POWER_PIN) {
+    digitalWrite(powerPin, HIGH);
+    pinMode(powerPin, OUTPUT);
+  }
+  AT_COMMAND(pt, F("AT"));
+
+  /*
+   * Configure TEXT mode with the texts in the GSM 03.38 alphabet and status
+   * reports, select the network and request PSM and eDRX from it (it may
+   * grant other timers), all on one line
+   */
+  AT_COMMAND(pt, F("AT+CMGF=1;+CSCS=\"GSM\";+CSMP=" SMS_FIRST_OCTET
+      ",167,0,0;+CNMI=2,1,0,1,0;+CNMP=" SIM7000_NETWORK_MODE
+      ";+CMNB=" SIM7000_ACCESS ";+CPSMS=1,,,\"" PSM_PERIODIC_TAU "\",\""
+      PSM_ACTIVE_TIME "\";+CEDRXS=1,5,\"" EDRX_CYCLE "\""));
+  finish(true);
+  PT_END(pt);
+}
+
+void Sim7000Modem::printBearer() {
+
+  // The bearer of the SIM7000 takes the access data directly
+  serial.print(F("AT+SAPBR=3,1,\"Contype\",\"GPRS\";"
+      "+SAPBR=3,1,\"APN\",\""));
+  serial.print(apn);
+  serial.print(F("\";+SAPBR=3,1,\"USER\",\""));
+  serial.print(apnUser);
+  serial.print(F("\";+SAPBR=3,1,\"PWD\",\""));
+  serial.print(apnPw);
+  serial.println('"');
+}
+
+const __FlashStringHelper *Sim7000Modem::registrationQuery() {
+
+  // LTE-M and NB-IoT register in the EPS network
+  return F("AT+CEREG?");
+}
+
+uint8_t Sim7000Modem::sleep(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_CONTROL);
+
+  // The module enters PSM on its own after the active time
+  sendCommand(F("AT+CPSMS=1"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  finish(response() == AT_OK);
+  PT_END(pt);
+}
+
+uint8_t Sim7000Modem::wake(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_CONTROL);
+  sendCommand(F("AT"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  if (response() == AT_OK || powerPin == NO_POWER_PIN) {
+    finish(response() == AT_OK);
+    PT_EXIT(pt);
+  }
+
+  // The module is in PSM, a pulse on the power key wakes it up
+  digitalWrite(powerPin, LOW);
+  timer = millis();
+  PT_WAIT_UNTIL(pt, millis() - timer >= POWER_KEY_PULSE);
+  digitalWrite(powerPin, HIGH);
+  timer = millis();
+  do {
+    sendCommand(F("AT"), atOk, 500);
+    PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  } while (response() != AT_OK && millis() - timer < WAKE_TIMEOUT);
+  finish(response() == AT_OK);
+  PT_END(pt);
+}
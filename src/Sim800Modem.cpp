@@ -0,0 +1,425 @@
+#include "Sim800Modem.h"
+
+/**
+ * Copies a quoted field of a response line, e.g. the number of +CMGR.
+ * @param from  Given response line
+ * @param field Given index of the quoted field, counting from 0
+ * @param to    Copied field, empty if the line has too few fields
+ * @param size  Given size of the buffer for the field
+ */
+static void copyQuoted(const char *from, uint8_t field, char *to,
+    uint8_t size) {
+  to[0] = '\0';
+  for (uint8_t i = 0; i <= field * 2; i++) {
+    from = strchr(from, '"');
+    if (from == NULL) {
+      return;
+    }
+    from++;
+  }
+  const char *end = strchr(from, '"');
+  if (end == NULL) {
+    return;
+  }
+  uint8_t length = min(end - from, size - 1);
+  memcpy(to, from, length);
+  to[length] = '\0';
+}
+
+/**
+ * Writes the TPDU of one part of a data sms as hex digits, without the
+ * address of the service center in front of it.
+ * @param out       Given output
+ * @param number    Given number of the recipient in international format
+ *                  ("+49...") or in national format
+ * @param data      Given writer of the whole data
+ * @param reference Given reference of the data
+ * @param part      Given index of the part
+ */
+static void writePdu(Print &out, const __FlashStringHelper *number,
+    BodyWriter data, uint8_t reference, uint8_t part) {
+  const char *digits = (const char *) number;
+  boolean international = pgm_read_byte(digits) == '+';
+  if (international) {
+    digits++;
+  }
+  uint32_t total = measureBody(data);
+  uint32_t offset = (uint32_t) part * SMS_PART_SIZE;
+  uint8_t length = offset < total ? min(total - offset, SMS_PART_SIZE) : 0;
+  writeHex(out, PDU_FIRST_OCTET);
+
+  // Message reference is set by the module
+  writeHex(out, 0);
+
+  // Address is the number of digits, its type and the swapped digits
+  writeHex(out, strlen_P(digits));
+  writeHex(out, international ? 0x91 : 0x81);
+  for (uint8_t i = 0; pgm_read_byte(digits + i) != '\0'; i += 2) {
+    char high = pgm_read_byte(digits + i + 1);
+    out.write(high == '\0' ? 'F' : high);
+    out.write(pgm_read_byte(digits + i));
+    if (high == '\0') {
+      break;
+    }
+  }
+  writeHex(out, 0);
+  writeHex(out, PDU_DATA_CODING);
+  writeHex(out, PDU_VALIDITY);
+  writeHex(out, SMS_UDH_SIZE + length);
+
+  // Concatenation header: length, IEI 0, its length, reference, parts, part
+  writeHex(out, SMS_UDH_SIZE - 1);
+  writeHex(out, 0);
+  writeHex(out, 3);
+  writeHex(out, reference);
+  writeHex(out, (total + SMS_PART_SIZE - 1) / SMS_PART_SIZE);
+  writeHex(out, part + 1);
+  HexWindowPrint window(out, offset, length);
+  data(window);
+}
+
+Sim800Modem::Sim800Modem(Stream &serial, const __FlashStringHelper *apn,
+    const __FlashStringHelper *apnUser, const __FlashStringHelper *apnPw,
+    uint8_t powerPin)
+    : Modem(serial, apn, apnUser, apnPw, powerPin), ipdMatched(0),
+      ipdLength(0), ipdReceived(0), ipdPayload(false) {
+}
+
+uint8_t Sim800Modem::begin(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_CONTROL);
+  AT_COMMAND(pt, F("AT"));
+
+  /*
+   * Configuring TEXT mode with the texts in the GSM 03.38 alphabet, request
+   * a status report for every sms and let them be sent as +CDS, all on one
+   * line
+   */
+  AT_COMMAND(pt, F("AT+CMGF=1;+CSCS=\"GSM\";+CSMP=" SMS_FIRST_OCTET
+      ",167,0,0;+CNMI=2,1,0,1,0"));
+  finish(true);
+  PT_END(pt);
+}
+
+const __FlashStringHelper *Sim800Modem::registrationQuery() {
+  return F("AT+CREG?");
+}
+
+uint8_t Sim800Modem::checkNetwork(Pt *pt) {
+  char *status;
+  PT_BEGIN(pt);
+  measure(AT_STEP_CONTROL);
+
+  // Response is +CREG: <n>,<stat> with stat 1 (home) or 5 (roaming)
+  AT_COMMAND(pt, registrationQuery(), PSTR("REG:"));
+  status = strchr(line, ',');
+  finish(status != NULL && (atoi(status + 1) == 1 || atoi(status + 1) == 5));
+  PT_END(pt);
+}
+
+void Sim800Modem::printBearer() {
+
+  /*
+   * Configure the module for GPRS connection and send the access data for
+   * the APN (needed for GPRS connection) on the same line
+   */
+  serial.print(F("AT+SAPBR=3,1,\"Contype\",\"GPRS\";"));
+  printApn();
+}
+
+void Sim800Modem::printApn() {
+  serial.print(F("+CSTT=\""));
+  serial.print(apn);
+  serial.print(F("\",\""));
+  serial.print(apnUser);
+  serial.print(F("\",\""));
+  serial.print(apnPw);
+  serial.println('"');
+}
+
+uint8_t Sim800Modem::connect(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_BEARER);
+  beginCommand();
+  printBearer();
+  AT_EXPECT(pt, atOk);
+
+  // Command for connecting to the GPRS network
+  AT_COMMAND(pt, F("AT+SAPBR=1,1"), atOk, BEARER_TIMEOUT);
+
+  /*
+   * Check if we already got a ip (if this isn't executed some weird failures
+   * occurs), then initialize HTTP with SSL, set user ID to 1 (Needed HTTP
+   * param) and the type of the binary body, all on one line
+   */
+  AT_COMMAND(pt, F("AT+SAPBR=2,1;+HTTPINIT;+HTTPSSL=1;+HTTPPARA=\"CID\",1;"
+      "+HTTPPARA=\"CONTENT\",\"application/octet-stream\""));
+  finish(true);
+  PT_END(pt);
+}
+
+Print &Sim800Modem::beginUrl() {
+  measure(AT_STEP_REQUEST);
+  beginCommand();
+  serial.print(F("AT+HTTPPARA=\"URL\",\""));
+  return serial;
+}
+
+uint8_t Sim800Modem::endUrl(Pt *pt) {
+  PT_BEGIN(pt);
+  serial.println('"');
+  AT_EXPECT(pt, atOk);
+  finish(true);
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::httpPost(Pt *pt, BodyWriter body) {
+  char *status;
+  char *length;
+  PT_BEGIN(pt);
+  measure(AT_STEP_REQUEST);
+  beginCommand();
+  serial.print(F("AT+HTTPDATA="));
+  serial.print(measureBody(body));
+  serial.print(',');
+  serial.println(HTTP_DATA_TIMEOUT);
+  AT_EXPECT(pt, PSTR("DOWNLOAD"));
+  body(serial);
+  AT_EXPECT(pt, atOk, HTTP_DATA_TIMEOUT);
+  measure(AT_STEP_ACTION);
+  AT_COMMAND(pt, F("AT+HTTPACTION=1"));
+  AT_EXPECT(pt, PSTR("+HTTPACTION:"), HTTP_TIMEOUT);
+
+  // Response is +HTTPACTION: <method>,<status>,<length>
+  status = strchr(line, ',');
+  length = status == NULL ? NULL : strchr(status + 1, ',');
+  setResponseLength(length == NULL ? 0 : atoi(length + 1));
+  finish(status == NULL ? 0 : atoi(status + 1));
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::httpRead(Pt *pt, char *text, uint8_t size) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_ACTION);
+  text[0] = '\0';
+
+  // Response is +HTTPREAD: <length> and the body on the next lines
+  AT_COMMAND(pt, F("AT+HTTPREAD"), PSTR("+HTTPREAD:"));
+  AT_EXPECT(pt, PSTR(""));
+  strncpy(text, line, size - 1);
+  text[size - 1] = '\0';
+  AT_EXPECT(pt, atOk);
+  finish(true);
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::disconnect(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_TEARDOWN);
+
+  /*
+   * Not concatenated, the bearer has to be closed even if HTTP wasn't
+   * initialized
+   */
+  sendCommand(F("AT+HTTPTERM"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+
+  // Command to disconnect from the GPRS network
+  sendCommand(F("AT+SAPBR=0,1"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  finish(response() == AT_OK);
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::sendSms(Pt *pt, const char *number, BodyWriter text) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_SMS);
+
+  // Command to write a sms
+  beginCommand();
+  serial.print(F("AT+CMGS=\""));
+  serial.print(number);
+  serial.println('"');
+  expect(PSTR(">"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  if (response() != AT_OK) {
+
+    // Leave the input mode of the module if it's still in it
+    serial.write(27);
+    finish(false);
+    PT_EXIT(pt);
+  }
+  text(serial);
+
+  // HEX-Code of the char the SIM800L needs to know the end of the sms
+  serial.write(26);
+  AT_EXPECT(pt, PSTR("+CMGS:"), SMS_TIMEOUT);
+
+  // Response is +CMGS: <mr>
+  setSmsReference(atoi(strstr_P(line, PSTR("+CMGS:")) + 6));
+  finish(true);
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::sendDataSms(Pt *pt, const __FlashStringHelper *number,
+    BodyWriter data, uint8_t reference, uint8_t part) {
+  CountingPrint counter;
+  PT_BEGIN(pt);
+  measure(AT_STEP_SMS);
+
+  // Binary data can only be sent in PDU mode
+  AT_COMMAND(pt, F("AT+CMGF=0"));
+
+  // Length of the TPDU in bytes, the hex digits count half
+  writePdu(counter, number, data, reference, part);
+  beginCommand();
+  serial.print(F("AT+CMGS="));
+  serial.println(counter.written() / 2);
+  expect(PSTR(">"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  if (response() == AT_OK) {
+
+    // Service center of the SIM card, followed by the TPDU
+    writeHex(serial, 0);
+    writePdu(serial, number, data, reference, part);
+    serial.write(26);
+    expect(PSTR("+CMGS:"), SMS_TIMEOUT);
+    PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  } else {
+
+    // Leave the input mode of the module if it's still in it
+    serial.write(27);
+  }
+  finish(response() == AT_OK);
+
+  // The alerts and answers are sent in TEXT mode
+  sendCommand(F("AT+CMGF=1"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::readSms(Pt *pt, uint8_t index, char *number,
+    uint8_t numberSize, char *text, uint8_t textSize) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_SMS);
+  number[0] = '\0';
+  text[0] = '\0';
+
+  // Response is +CMGR: "<stat>","<number>",... and the text on the next line
+  beginCommand();
+  serial.print(F("AT+CMGR="));
+  serial.println(index);
+  AT_EXPECT(pt, PSTR("+CMGR:"));
+  copyQuoted(line, 1, number, numberSize);
+  AT_EXPECT(pt, PSTR(""));
+
+  // The final OK follows right away if the text is empty
+  if (strcmp_P(line, atOk) != 0) {
+    strncpy(text, line, textSize - 1);
+    text[textSize - 1] = '\0';
+    AT_EXPECT(pt, atOk);
+  }
+
+  // Free the storage, so it doesn't fill up with queries
+  beginCommand();
+  serial.print(F("AT+CMGD="));
+  serial.println(index);
+  AT_EXPECT(pt, atOk);
+  finish(true);
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::udpOpen(Pt *pt, const __FlashStringHelper *host,
+    uint16_t port) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_BEARER);
+
+  // Start from a closed TCP/IP stack
+  sendCommand(F("AT+CIPSHUT"), PSTR("SHUT OK"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+
+  /*
+   * Single connection, received data is prefixed with +IPD,<length>: and the
+   * access data of the APN, all on one line
+   */
+  beginCommand();
+  serial.print(F("AT+CIPMUX=0;+CIPHEAD=1;"));
+  printApn();
+  AT_EXPECT(pt, atOk);
+  AT_COMMAND(pt, F("AT+CIICR"), atOk, BEARER_TIMEOUT);
+
+  // Response is the ip address of the module without an OK
+  AT_COMMAND(pt, F("AT+CIFSR"), PSTR("."));
+  beginCommand();
+  serial.print(F("AT+CIPSTART=\"UDP\",\""));
+  serial.print(host);
+  serial.print(F("\",\""));
+  serial.print(port);
+  serial.println('"');
+  AT_EXPECT(pt, PSTR("CONNECT OK"), BEARER_TIMEOUT);
+  ipdMatched = 0;
+  ipdPayload = false;
+  finish(true);
+  PT_END(pt);
+}
+
+uint8_t Sim800Modem::udpSend(Pt *pt, const uint8_t *data, uint8_t length) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_REQUEST);
+  beginCommand();
+  serial.print(F("AT+CIPSEND="));
+  serial.println(length);
+  AT_EXPECT(pt, PSTR(">"));
+  serial.write(data, length);
+  AT_EXPECT(pt, PSTR("SEND OK"));
+  finish(true);
+  PT_END(pt);
+}
+
+int Sim800Modem::udpRead(uint8_t *buffer, uint8_t size) {
+  static const char header[] PROGMEM = "+IPD,";
+  while (serial.available()) {
+    char c = serial.read();
+    if (ipdPayload) {
+      if (ipdReceived < size) {
+        buffer[ipdReceived] = c;
+      }
+      if (++ipdReceived == ipdLength) {
+        ipdMatched = 0;
+        ipdPayload = false;
+        return ipdLength;
+      }
+    } else if (pgm_read_byte(header + ipdMatched) == '\0') {
+
+      // Length of the datagram up to the colon
+      if (c == ':') {
+        ipdPayload = ipdLength > 0;
+        ipdReceived = 0;
+        if (!ipdPayload) {
+          ipdMatched = 0;
+        }
+      } else if (c >= '0' && c <= '9') {
+        ipdLength = ipdLength * 10 + c - '0';
+      } else {
+        ipdMatched = 0;
+      }
+    } else {
+      Serial.write(c);
+      ipdMatched = c == (char) pgm_read_byte(header + ipdMatched)
+          ? ipdMatched + 1 : (c == (char) pgm_read_byte(header) ? 1 : 0);
+      ipdLength = 0;
+    }
+  }
+  return -1;
+}
+
+uint8_t Sim800Modem::udpClose(Pt *pt) {
+  PT_BEGIN(pt);
+  measure(AT_STEP_TEARDOWN);
+  sendCommand(F("AT+CIPCLOSE"), PSTR("CLOSE OK"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  sendCommand(F("AT+CIPSHUT"), PSTR("SHUT OK"));
+  PT_WAIT_UNTIL(pt, poll() != AT_PENDING);
+  finish(response() == AT_OK);
+  PT_END(pt);
+}
@@ -0,0 +1,59 @@
+#include "UploadSlot.h"
+#include "EEPROM.h"
+
+// 2^16 divided by the golden ratio, spreads consecutive ids evenly
+#define FIBONACCI_MULTIPLIER 40503U
+
+/**
+ * Calculates the checksum of a given assignment.
+ * @param  assignment Given assignment
+ * @return Returns the checksum.
+ */
+static uint8_t checksumOf(const SlotAssignment &assignment) {
+  return ~(assignment.magic ^ (assignment.offset >> 8) ^ assignment.offset);
+}
+
+uint16_t loadSlotOffset() {
+  SlotAssignment assignment;
+  EEPROM.get(SLOT_ADDR, assignment);
+  if (assignment.magic != SLOT_MAGIC
+      || assignment.checksum != checksumOf(assignment)
+      || assignment.offset > SLOT_MAX) {
+    return NO_SLOT;
+  }
+  return assignment.offset;
+}
+
+boolean saveSlotOffset(uint16_t offset) {
+  if (offset > SLOT_MAX) {
+    return false;
+  }
+  SlotAssignment assignment;
+  assignment.magic = SLOT_MAGIC;
+  assignment.offset = offset;
+  assignment.checksum = checksumOf(assignment);
+  EEPROM.put(SLOT_ADDR, assignment);
+  return true;
+}
+
+uint16_t parseSlotOffset(const char *text) {
+  uint16_t offset = 0;
+  if (*text == '\0') {
+    return NO_SLOT;
+  }
+  for (; *text != '\0'; text++) {
+    if (*text < '0' || *text > '9' || offset > SLOT_MAX) {
+      return NO_SLOT;
+    }
+    offset = offset * 10 + *text - '0';
+  }
+  return offset > SLOT_MAX ? NO_SLOT : offset;
+}
+
+uint16_t slotOffset(uint16_t stationId, uint16_t assigned, uint16_t period) {
+  if (assigned != NO_SLOT) {
+    return assigned % period;
+  }
+  uint16_t hash = stationId * FIBONACCI_MULTIPLIER;
+  return (uint32_t) hash * period >> 16;
+}
@@ -0,0 +1,133 @@
+#include "WaterSensor.h"
+
+/**
+ * Sorts a few values in place.
+ * @param values Given values
+ * @param count  Number of values
+ */
+static void sortValues(int16_t values[], uint8_t count) {
+  for (uint8_t i = 1; i < count; i++) {
+    int16_t value = values[i];
+    uint8_t j = i;
+    for (; j > 0 && values[j - 1] > value; j--) {
+      values[j] = values[j - 1];
+    }
+    values[j] = value;
+  }
+}
+
+WaterSensor::WaterSensor()
+    : lastDistance(INVALID_DIST), lastValid(false), score(HEALTH_MAX),
+      windowIndex(0), windowCount(0), frozenFused(INVALID_DIST), stuck(false),
+      driftHigh(0), driftLow(0), found(0) {
+}
+
+boolean WaterSensor::accept(int dist) {
+  lastValid = dist != INVALID_DIST && !isSpike(dist);
+  if (!lastValid) {
+    if (dist != INVALID_DIST) {
+      found |= ANOMALY_SPIKE;
+    }
+    score = score > HEALTH_LOSS ? score - HEALTH_LOSS : 0;
+    return false;
+  }
+  if (dist != lastDistance) {
+    frozenFused = INVALID_DIST;
+    stuck = false;
+  }
+  lastDistance = dist;
+
+  // A stuck sensor decays to just enough weight to stay in the fusion
+  if (stuck) {
+    score = score > HEALTH_MIN + HEALTH_GAIN ? score - HEALTH_GAIN : HEALTH_MIN;
+    return true;
+  }
+  score = score < HEALTH_MAX - HEALTH_GAIN ? score + HEALTH_GAIN : HEALTH_MAX;
+  return true;
+}
+
+boolean WaterSensor::isSpike(int dist) {
+  boolean spike = false;
+  if (windowCount == ANOMALY_WINDOW) {
+    int16_t sorted[ANOMALY_WINDOW];
+    memcpy(sorted, window, sizeof(sorted));
+    sortValues(sorted, ANOMALY_WINDOW);
+    int16_t median = sorted[ANOMALY_WINDOW / 2];
+    for (uint8_t i = 0; i < ANOMALY_WINDOW; i++) {
+      sorted[i] = abs(sorted[i] - median);
+    }
+    sortValues(sorted, ANOMALY_WINDOW);
+    int16_t mad = max(sorted[ANOMALY_WINDOW / 2], (int16_t) SPIKE_MIN_MAD);
+
+    // z = 0.6745 * deviation / MAD, compared in tenths without floats
+    spike = (long) abs(dist - median) * 6745L > (long) SPIKE_Z * mad * 1000L;
+  } else {
+    windowCount++;
+  }
+
+  // A spike is kept in the window, so a real step is accepted after a while
+  window[windowIndex] = dist;
+  windowIndex = (windowIndex + 1) % ANOMALY_WINDOW;
+  return spike;
+}
+
+void WaterSensor::track(int fused) {
+  if (!lastValid || fused == INVALID_DIST) {
+    return;
+  }
+  if (frozenFused == INVALID_DIST) {
+    frozenFused = fused;
+  } else if (abs(fused - frozenFused) >= STUCK_MOVE) {
+    found |= ANOMALY_STUCK;
+    stuck = true;
+  }
+  int deviation = lastDistance - fused;
+  driftHigh = max(0, driftHigh + deviation - DRIFT_SLACK);
+  driftLow = max(0, driftLow - deviation - DRIFT_SLACK);
+  if (driftHigh > DRIFT_LIMIT || driftLow > DRIFT_LIMIT) {
+    found |= ANOMALY_DRIFT;
+    score = score > HEALTH_LOSS ? score - HEALTH_LOSS : 0;
+    driftHigh = 0;
+    driftLow = 0;
+  }
+}
+
+PressureSensor::PressureSensor(uint8_t pin, int zeroRaw, int spanRaw,
+    int spanCm, int mountCm)
+    : pin(pin), zeroRaw(zeroRaw), spanRaw(spanRaw), spanCm(spanCm),
+      mountCm(mountCm) {
+}
+
+int PressureSensor::readDistance() {
+  int raw = analogRead(pin);
+
+  // Values outside of the span mean a broken wire or a shorted transducer
+  if (raw < zeroRaw || raw > spanRaw) {
+    return INVALID_DIST;
+  }
+  long depth = (long) (raw - zeroRaw) * spanCm * MM_PER_CM
+      / (spanRaw - zeroRaw);
+  return mountCm * MM_PER_CM - (int) depth;
+}
+
+int fuseSensors(WaterSensor *sensors[], uint8_t count) {
+  long weightedSum = 0;
+  long weights = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    WaterSensor *sensor = sensors[i];
+    if (sensor != NULL && sensor->valid() && !sensor->failed()) {
+      weightedSum += (long) sensor->distance() * sensor->health();
+      weights += sensor->health();
+    }
+  }
+  if (weights == 0) {
+    return INVALID_DIST;
+  }
+  int fused = (weightedSum + weights / 2) / weights;
+  for (uint8_t i = 0; i < count; i++) {
+    if (sensors[i] != NULL) {
+      sensors[i]->track(fused);
+    }
+  }
+  return fused;
+}
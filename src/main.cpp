@@ -1,68 +1,141 @@
 #include "Arduino.h"
 #include "RTClib.h"
-#include "NewPing.h"
 #include "SoftwareSerial.h"
 #include "Wire.h"
+#include "WaterSensor.h"
+#include "Calibration.h"
+#include "PowerMonitor.h"
+#include "StationProfile.h"
+#include "RtcService.h"
+#include "CoapClient.h"
+#include "Payload.h"
+#include "Protothread.h"
+#include "AlertLatency.h"
+#include "TokenBucket.h"
+#include "CircuitBreaker.h"
+#include "Messages.h"
+#include "Recipients.h"
+#include "ReadingLog.h"
+#include "UploadSlot.h"
 
 /**
  * This is a small IoT project, to automatically messure the water height of
  * the Freudensee located in Hauzenberg.
  * This is the code of the transmitter station, which provides the messure of
- * the water heigth by using the HC-SR04 ultra sonic sensor.
+ * the water heigth by using one or more HC-SR04 ultra sonic sensors and an
+ * optional pressure sensor.
  * After the water heigth is messured the data will be sent every 2 hours to a
  * server over the GPRS network using the SIM800L module.
+ * The messurement and the module are driven by protothreads, so sms alerts
+ * and uploads don't stop the messurement while the module is busy.
  */
 
-// First critical point (20 cm under foodbridge)
-#define CRIT_DIST_1 3
+// Create software serial object to communicate with SIM800L
+SoftwareSerial mySerial(Station::TX_PIN, Station::RX_PIN);
 
-// Second critical point (10 cm under foodbridge
-#define CRIT_DIST_2 2
+// Driver of the cellular module
+Station::ModemDriver modem(mySerial, Station::apn(), Station::apnUser(),
+    Station::apnPw(), Station::MODEM_POWER_PIN);
 
-// Third critical point (water entering the hut)
-#define CRIT_DIST_3 1
+// CoAP client for the uploads over UDP, only held by the CoAP stations
+OptionalCoapClient<Station::UPLOAD_COAP, Station::ModemDriver> coap(modem);
 
- // Size of allowed numbers
-#define SIZE_OF_ALLOWED_NUMBERS 5
+// Readings which wait for the acknowledgement of the server
+ReadingLog readingLog;
 
-// Trigger of the ultra sonic module
-#define TRIGGER_PIN 7
+// Number of logged readings in the current upload
+uint8_t uploadCount = 0;
 
-// Echo of the ultra sonic module
-#define ECHO_PIN 6
+// Number of uploads since the statistics of the module were accepted
+uint8_t atStatsAge = Station::AT_STATS_UPLOADS;
 
-// The maximum distance to be messured
-#define MAX_DIST 400
+// Boolean if the current upload includes the statistics of the module
+boolean uploadAtStats = false;
 
-// The minimum distance to be messured
-#define MIN_DIST 0
+// Size of the buffer for the response of the server to an upload
+#define RESPONSE_SIZE 8
 
-// TX pin of the SIM800L module
-#define TX_PIN 2
+// Response of the server to the current upload
+char serverResponse[RESPONSE_SIZE];
 
-// RX pin of the SIM800L module
-#define RX_PIN 3
+// Breaker which suspends the uploads while the connection keeps failing
+CircuitBreaker<Station::LINK_FAILURES, Station::LINK_BACKOFF_MIN_MS,
+    Station::LINK_BACKOFF_MAX_MS> linkBreaker;
 
-// Server URL
-#define SERVER_URL "ServerURL"
+// Failed connections since the start
+LinkStats linkStats;
 
-// Server password
-#define SERVER_PW "ServerPw"
+// Start of the current attempt to reach the server in ms
+unsigned long attemptStart = 0;
 
-// Interval in ms for trying to get valid values after getting invalid ones
-#define INTERVAL 1200000
+// Boolean if the server responded to the current upload
+boolean serverReached = false;
 
-// Create software serial object to communicate with SIM800L
-SoftwareSerial mySerial(TX_PIN, RX_PIN);
+// Sequence number of the first reading which wasn't sent by sms yet
+uint16_t smsSequence = 0;
+
+// Number of logged readings in the current data sms
+uint8_t smsCount = 0;
+
+// Reference of the current data sms, so the gateway reassembles its parts
+uint8_t smsReference = 0;
+
+// Number of parts of the current data sms
+uint8_t smsParts = 0;
+
+// Index of the part of the data sms which is sent
+uint8_t smsPart = 0;
 
-// Create a NewPing object to communicate with the ultra sonic sensor.
-NewPing sonar(TRIGGER_PIN, ECHO_PIN, MAX_DIST);
+// Boolean if the readings wait to be sent by sms
+boolean fallbackPending = false;
 
-// Create a RTClib object to communicate with rtc module.
-RTC_DS3231 rtc;
+// Prefix of the lines of the serial monitor which are commands of the station
+#define STATION_COMMAND '!'
+
+// Size of the buffer for a command of the station
+#define COMMAND_SIZE 24
+
+// Command of the station which is typed in and its length
+char command[COMMAND_SIZE];
+uint8_t commandLength = 0;
+
+// Boolean if the current line of the serial monitor is a command
+boolean inCommand = false;
+
+// Boolean if the next char of the serial monitor starts a line
+boolean lineStart = true;
+
+/*
+ * Ultra sonic sensors to messure the water heigth, they are triggered one
+ * after another.
+ */
+UltrasonicSensor<Station::TRIGGER_PIN, Station::ECHO_PIN> sonar(
+    Station::MAX_DIST, Station::MIN_DIST);
+OptionalSensor<UltrasonicSensor<Station::TRIGGER_PIN_2, Station::ECHO_PIN_2>,
+    Station::SONAR_COUNT == 2> sonar2(Station::MAX_DIST, Station::MIN_DIST);
 
-// String array of the numbers to get notifed
-String allowedNumbers[] = {};
+// Pressure sensor on the ground of the lake
+OptionalSensor<PressureSensor, Station::PRESSURE_PIN != NO_PIN> pressure(
+    Station::PRESSURE_PIN, Station::PRESSURE_ZERO_RAW,
+    Station::PRESSURE_SPAN_RAW, Station::PRESSURE_SPAN_CM,
+    Station::PRESSURE_MOUNT_CM);
+
+// All sensors which take part in the fusion of the water heigth
+WaterSensor *sensors[] = { &sonar, sonar2.get(), pressure.get() };
+
+// Number of sensors which take part in the fusion
+#define SENSOR_COUNT (sizeof(sensors) / sizeof(sensors[0]))
+
+// Monitoring of the supply voltage
+PowerMonitor power(Station::SUPPLY_LOW_MV, Station::SUPPLY_CRITICAL_MV,
+    Station::BATTERY_PIN, Station::BATTERY_DIVIDER_NUM,
+    Station::BATTERY_DIVIDER_DEN);
+
+// Cached access to the rtc module
+RtcService rtc;
+
+// Analog input of the Nano which isn't wired, its noise seeds random()
+#define SEED_PIN A7
 
 // Boolean if criticial point 1 is reached and the corresponding warning is sent
 boolean warning1Sent = false;
@@ -73,235 +146,1257 @@ boolean warning2Sent = false;
 // Boolean if criticial point 3 is reached and the corresponding warning is sent
 boolean warning3Sent = false;
 
-// Boolean if data were sent to the server
-boolean dataSent = false;
+// Number of the upload period in which data were sent to the server last
+uint32_t lastSlot = 0;
+
+// Offset in s of the upload slot assigned by the server or NO_SLOT
+uint16_t assignedSlot = NO_SLOT;
+
+// Random delay in s of the next upload
+uint8_t uploadJitter = 0;
 
 // Boolean if there's a messure failure
 boolean messureFail = false;
 
-// Messured heigth of the water
+// Messured distance from the sensors to the water surface in cm
+int messuredDistance = 0;
+
+// Messured heigth of the water (level above datum in cm)
 int messuredHeigth = 0;
 
 // Time in ms since the last correct messurement
 long previousMillis = 0;
 
+// Number of sms alerts which can wait for the module
+#define ALERT_QUEUE_SIZE 8
+
+/**
+ * Sms alert which waits for the module.
+ */
+struct QueuedAlert {
+
+  // Message code of the alert (MessageCode)
+  uint8_t code;
+
+  // Time in ms of the sample which caused the alert
+  unsigned long crossed;
+
+  // Time in ms the alert was queued
+  unsigned long queued;
+
+  // Index of the only recipient or ALL_RECIPIENTS
+  uint8_t target;
+
+  // Number of times the alert was sent to this recipient before
+  uint8_t attempt;
+};
+
+// Marker for an alert to all recipients of its message
+#define ALL_RECIPIENTS 0xFF
+
+// Sms alerts which wait for the module, the oldest first
+QueuedAlert alertQueue[ALERT_QUEUE_SIZE];
+
+// Number of sms alerts which wait for the module
+uint8_t alertCount = 0;
+
+// Boolean if an upload waits for the module
+boolean uploadPending = false;
+
+// Boolean if the module runs an alert or an upload
+boolean modemBusy = false;
+
+// Boolean if the station stopped messuring because of a hardware failure
+boolean halted = false;
+
+// State of the protothread which messures the water heigth
+Pt sampleThreadState;
+
+// State of the protothread which drives the module
+Pt modemThreadState;
+
+// State of the alert or upload which is run by the module
+Pt flowState;
+
+// State of the flow of the driver which is run by an alert or upload
+Pt driverState;
+
+// State of the transfer which is run by an upload
+Pt transferState;
+
+// Start of the current messurement and of the last sensor reading in ms
+unsigned long sampleStart = 0;
+unsigned long sensorStart = 0;
+
+// Index of the sensor which is read next
+uint8_t sensorIndex = 0;
+
+// Number of times a disturbed reading is repeated
+#define SENSOR_RETRIES 3
+
+// Raw distance of the current reading in cm and the number of repetitions
+int rawDistance = INVALID_DIST;
+uint8_t sensorRetries = 0;
+
+// Number of bytes of the module waiting before the current reading
+int rxWaiting = 0;
+
+// Index of the number which gets the current sms next
+uint8_t recipientIndex = 0;
+
+// Number which gets the current sms
+Recipient recipient;
+
+// Message of the sms which is currently sent (MessageCode)
+int smsCode = MSG_LEVEL;
+
+// Time in ms the current sms was sent to the module (AT+CMGS)
+unsigned long smsStart = 0;
+
+// Latency of the sms alerts
+AlertLatency alertLatency(Station::ALERT_SLO_MS);
+
+// Boolean if the oldest queued alert is currently sent
+boolean alertInFlight = false;
+
+// Rate limit of the sms to each number
+TokenBucket<Station::SMS_BURST, Station::SMS_REFILL_MS>
+    smsBuckets[RECIPIENT_COUNT];
+
+// Critical point (0 to 3) each number was told about last
+uint8_t notifiedLevel[RECIPIENT_COUNT];
+
+// Boolean per number if a cleared critical point was held back by the limit
+boolean clearHeldBack[RECIPIENT_COUNT];
+
+// Size of the buffer for the text of a received sms (only the keyword counts)
+#define QUERY_TEXT_SIZE 12
+
+// Storage index and text of the received sms which is currently answered
+uint8_t queryIndex = 0;
+char queryText[QUERY_TEXT_SIZE];
+
+// Rate limit of the answers to the queries of all residents together
+TokenBucket<Station::QUERY_BURST, Station::QUERY_REFILL_MS> queryBucket;
+
+// Number of uploads the crossings of the critical points may queue in a burst
+#define CROSSING_UPLOAD_BURST 2
+
+// Time in ms after which a crossing may queue one more upload
+#define CROSSING_UPLOAD_REFILL_MS 600000
+
+// Rate limit of the uploads which are queued by crossings
+TokenBucket<CROSSING_UPLOAD_BURST, CROSSING_UPLOAD_REFILL_MS> crossingUploads;
+
+// Marker for a recipient which doesn't get the current alert
+#define NO_MESSAGE -1
+
+// Number of sent sms whose delivery is tracked
+#define DELIVERY_SLOTS (RECIPIENT_COUNT + 1)
+
+// Time in ms to wait for the status report of a sms
+#define DELIVERY_TIMEOUT 600000
+
+// Number of times an undelivered critical alert is sent again
+#define DELIVERY_RETRIES 1
+
+// Marker for a free delivery slot
+#define NO_RECIPIENT 0xFF
+
+/**
+ * Sent sms which waits for its status report.
+ */
+struct Delivery {
+
+  // Message reference of the sms
+  uint8_t reference;
+
+  // Index of the recipient or NO_RECIPIENT if the slot is free
+  uint8_t recipient;
+
+  // Message code and attempt of the alert
+  uint8_t code;
+  uint8_t attempt;
+
+  // Critical point the recipient was told about before
+  uint8_t previousLevel;
+
+  // Time in ms of the sample which caused the alert
+  unsigned long crossed;
+
+  // Time in ms the network accepted the sms
+  unsigned long sent;
+};
+
+// Sent sms which wait for their status report
+Delivery deliveries[DELIVERY_SLOTS];
+
+// Delivery statistics of each number since the last upload
+DeliveryStats deliveryStats[RECIPIENT_COUNT];
+
+/**
+ * Statistics which go with the current upload or data sms. They're copied
+ * when it starts, so every pass over the body writes the same bytes, even if
+ * a status report or a command of the module comes in between.
+ */
+struct BodyStats {
+  DeliveryStats delivery[RECIPIENT_COUNT];
+  AtStats at[AT_STEP_COUNT];
+  LinkStats link;
+};
+
+// Statistics of the current upload or data sms
+BodyStats bodyStats;
+
+// Boolean if the server accepted the current upload
+boolean uploadAccepted = false;
+
+// HTTP status of a server which signals backpressure
+#define HTTP_TOO_MANY_REQUESTS 429
+#define HTTP_SERVICE_UNAVAILABLE 503
+
+// Shortest and longest time in ms an upload is deferred by backpressure
+#define BACKOFF_MIN 60000UL
+#define BACKOFF_MAX 3600000UL
+
+// Start and duration in ms of the deferral asked for by the server
+unsigned long backoffStart = 0;
+unsigned long uploadBackoff = 0;
+
+/**
+ * @return Returns true if an upload waits and the server doesn't ask to hold
+ *         off any longer.
+ */
+boolean uploadDue() {
+  return uploadPending && millis() - backoffStart >= uploadBackoff;
+}
+
+/**
+ * @return Returns true if the module has something to do, so it's kept awake.
+ */
+boolean modemWanted() {
+  return alertCount > 0 || modem.smsWaiting() || uploadDue()
+      || fallbackPending;
+}
+
+/**
+ * Defers the upload because the server is overloaded. Without a time given by
+ * the server the deferral doubles with every refused upload.
+ * @param delay Given time in ms to hold off or 0 if the server gave none
+ */
+void deferUpload(unsigned long delay) {
+  if (delay == 0) {
+    delay = uploadBackoff == 0 ? BACKOFF_MIN : uploadBackoff * 2;
+  }
+  uploadBackoff = min(delay, BACKOFF_MAX);
+  backoffStart = millis();
+  uploadPending = true;
+  Serial.print(F("Server ausgelastet, Upload verschoben um s:"));
+  Serial.println(uploadBackoff / 1000);
+}
+
+/**
+ * Prints the statistics of all steps of the module: the number of responses
+ * per latency bucket, the errors and the timeouts.
+ */
+void printAtStats() {
+  for (uint8_t i = 0; i < AT_STEP_COUNT; i++) {
+    const AtStats &stats = modem.stats((AtStep) i);
+    Serial.print(F("AT Schritt "));
+    Serial.print(i);
+    Serial.print(':');
+    for (uint8_t j = 0; j < AT_LATENCY_BUCKETS; j++) {
+      Serial.print(' ');
+      Serial.print(stats.latency[j]);
+    }
+    Serial.print(F(" Fehler "));
+    Serial.print(stats.errors);
+    Serial.print(F(" Timeouts "));
+    Serial.println(stats.timeouts);
+  }
+}
+
+/**
+ * Takes the next whole number from the arguments of a command.
+ * @param  args  Given arguments, moved behind the number
+ * @param  value Taken number
+ * @return Returns false if there's no number.
+ */
+boolean takeNumber(char *&args, long &value) {
+  char *end;
+  value = strtol(args, &end, 10);
+  if (end == args) {
+    return false;
+  }
+  args = end;
+  return true;
+}
+
+/**
+ * Runs a command which enters the calibration: "CAL <offset>" begins a new
+ * one, "CALP <distance> <level>" appends a point to it.
+ * @param  point Given boolean if the command appends a point
+ * @param  args  Given arguments of the command
+ * @return Returns false if the arguments are invalid.
+ */
+boolean runCalibrationCommand(boolean point, char *args) {
+  long first;
+  long second;
+  if (!takeNumber(args, first)) {
+    return false;
+  }
+  if (!point) {
+    beginCalibration(first);
+    return true;
+  }
+  return takeNumber(args, second) && addCalibrationPoint(first, second);
+}
+
+/**
+ * Runs the command which enters a recipient: "NR <index> <language>
+ * <number>" stores it, "NR <index>" removes it. The language is the index
+ * of the Language (0 German, 1 English).
+ * @param  args Given arguments of the command
+ * @return Returns false if the arguments are invalid.
+ */
+boolean runRecipientCommand(char *args) {
+  long index;
+  long language;
+  Recipient entry;
+  if (!takeNumber(args, index) || index < 0) {
+    return false;
+  }
+  if (!takeNumber(args, language)) {
+    return removeRecipient(index);
+  }
+  while (*args == ' ') {
+    args++;
+  }
+
+  // Only digits after an optional plus, the number ends up in AT commands
+  const char *digits = *args == '+' ? args + 1 : args;
+  if (language < 0 || strlen(args) >= NUMBER_SIZE
+      || strspn_P(digits, PSTR("0123456789")) != strlen(digits)) {
+    return false;
+  }
+  memset(&entry, 0, sizeof(entry));
+  strcpy(entry.number, args);
+  entry.language = language;
+  return saveRecipient(index, entry);
+}
+
+/**
+ * Runs the command of the station which was typed in.
+ */
+void runCommand() {
+  boolean done = true;
+  command[commandLength] = '\0';
+  if (strcmp_P(command, PSTR("AT")) == 0) {
+    printAtStats();
+  } else if (strncmp_P(command, PSTR("NR "), 3) == 0) {
+    done = runRecipientCommand(command + 3);
+  } else if (strncmp_P(command, PSTR("CALP "), 5) == 0) {
+    done = runCalibrationCommand(true, command + 5);
+  } else if (strncmp_P(command, PSTR("CAL "), 4) == 0) {
+    done = runCalibrationCommand(false, command + 4);
+  } else {
+    Serial.println(F("Unbekannter Befehl"));
+    return;
+  }
+  Serial.println(done ? F("OK") : F("Ungueltige Eingabe"));
+}
+
 /**
  * Method which providing the hand off of commands from the Arduino to the
- * SIM800L module and vise versa.
+ * SIM800L module and vise versa. Lines starting with STATION_COMMAND are
+ * commands of the station itself, ended by a new line: !AT prints the
+ * statistics of the module, !CAL <offset> followed by !CALP <distance>
+ * <level> for each point with ascending distances enters the calibration,
+ * !NR <index> <language> <number> enters a recipient of the sms.
  */
 void updateSerial() {
-  delay(500);
   while (Serial.available()) {
+    char c = Serial.read();
+    if (lineStart && c == STATION_COMMAND) {
+      inCommand = true;
+      commandLength = 0;
+    } else if (inCommand) {
+      if (c == '\n') {
+        inCommand = false;
+        runCommand();
+      } else if (c != '\r' && commandLength < COMMAND_SIZE - 1) {
+        command[commandLength++] = c;
+      }
+    } else {
+
+      //Forward what Serial received to Software Serial Port
+      mySerial.write(c);
+    }
+    lineStart = c == '\n';
+  }
+
+  // Forward what the module sent to Serial Port, keeping its status reports
+  modem.idle();
+}
+
+/**
+ * Writes the text of the current sms in the language of its recipient.
+ * @param out Given output
+ */
+void writeSmsText(Print &out) {
+  writeMessage(out, (MessageCode) smsCode, (Language) recipient.language,
+      messuredHeigth);
+}
+
+/**
+ * @param  messageCode The given message code
+ * @return Returns true if the message tells about a critical point.
+ */
+boolean isLevelAlert(int messageCode) {
+  return messageCode >= MSG_LEVEL_1_REACHED
+      && messageCode <= MSG_LEVEL_3_CLEARED;
+}
 
-    //Forward what Serial received to Software Serial Port
-    mySerial.write(Serial.read());
+/**
+ * @param  messageCode Given message code of a level alert
+ * @return Returns the critical point (0 to 3) reached after the alert.
+ */
+uint8_t alertLevel(int messageCode) {
+  if (messageCode <= MSG_LEVEL_3_REACHED) {
+    return messageCode - MSG_LEVEL_1_REACHED + 1;
   }
-  while(mySerial.available()) {
+  return messageCode - MSG_LEVEL_1_CLEARED;
+}
 
-    //Forward what Software Serial received to Serial Port
-    Serial.write(mySerial.read());
+/**
+ * @return Returns the highest critical point (0 to 3) which is reached.
+ */
+uint8_t currentLevel() {
+  if (warning3Sent) {
+    return 3;
+  }
+  if (warning2Sent) {
+    return 2;
   }
+  return warning1Sent ? 1 : 0;
 }
 
 /**
- * Method which creates a message corresponding to a given code and returns it.
- * @param  code The internal message code
- * @return Returns the created message.
+ * Queues a sms alert with the given message code for the module. A level
+ * alert supersedes the level alerts which are still waiting, so a level
+ * flapping around a critical point results in one alert about the current
+ * state. It keeps the time of the oldest superseded sample.
+ * @param messageCode The given message code
+ * @param crossed     Time in ms of the sample which caused the alert
+ * @param target      Index of the only recipient or ALL_RECIPIENTS
+ * @param attempt     Number of times the alert was sent before
  */
-String createMessage(int code) {
-  if (code < 0 || code > 8) {
-    return "Invalid ErrorCode";
+void queueAlert(MessageCode messageCode, unsigned long crossed,
+    uint8_t target = ALL_RECIPIENTS, uint8_t attempt = 0) {
+  if (isLevelAlert(messageCode)) {
+    uint8_t kept = alertInFlight ? 1 : 0;
+    for (uint8_t i = kept; i < alertCount; i++) {
+      if (isLevelAlert(alertQueue[i].code)
+          && (target == ALL_RECIPIENTS || alertQueue[i].target == target)) {
+        if ((long) (alertQueue[i].crossed - crossed) < 0) {
+          crossed = alertQueue[i].crossed;
+        }
+      } else {
+        alertQueue[kept++] = alertQueue[i];
+      }
+    }
+    alertCount = kept;
   }
-  switch (code) {
-    case 0:
-      return "Wasserstand: cm";
-    case 1:
-      return "Meldestufe 1 erreicht!!!\nWasserstand:  cm";
-    case 2:
-      return "Meldestufe 2 erreicht!!!\nWasserstand: cm";
-    case 3:
-      return "Wir saufen ab!!! Meldestufe 3 erreicht!!!\nWasserstand: cm";
-    case 4:
-      return "Meldestufe 1 aufgehoben!!!\nWasserstand: cm";
-    case 5:
-      return "Meldestufe 2 aufgehoben!!!\nWasserstand: cm";
-    case 6:
-      return "Meldestufe 3 aufgehoben!!!\nWasserstand: cm";
-    case 7:
-      return "Fehler mit dem Ultraschallsensor bitte Überprüfen!";
-    case 8:
-      return "Fehler mit dem RTC-Modul bitte überprüfen!";
+  if (alertCount == ALERT_QUEUE_SIZE) {
+    Serial.println(F("Zu viele Meldungen, Meldung verworfen"));
+    return;
   }
+  Serial.print(F("Meldung "));
+  Serial.println(messageCode);
+  QueuedAlert &alert = alertQueue[alertCount++];
+  alert.code = messageCode;
+  alert.crossed = crossed;
+  alert.queued = millis();
+  alert.target = target;
+  alert.attempt = attempt;
 }
 
 /**
- * Method which sends a sms with a given message to a given number.
- * @param number      Given number of the recipient
- * @param messageCode Given message to be sent
+ * Records the latency of the current alert for a recipient and prints its
+ * stages: sample to queue, queue to AT+CMGS and AT+CMGS to +CMGS.
  */
-void sendingSMS(String number, int messageCode) {
-  delay(500);
+void recordAlertLatency() {
+  const QueuedAlert &alert = alertQueue[0];
+  unsigned long confirmed = millis();
+  boolean inSlo = alertLatency.record(alert.crossed, confirmed);
+  Serial.print(F("Alarm-Latenz ms: Warteschlange "));
+  Serial.print(alert.queued - alert.crossed);
+  Serial.print(F(" Modul "));
+  Serial.print(smsStart - alert.queued);
+  Serial.print(F(" Netz "));
+  Serial.print(confirmed - smsStart);
+  Serial.print(F(" Gesamt "));
+  Serial.println(confirmed - alert.crossed);
+  if (!inSlo) {
+    Serial.println(F("Alarm-Latenz über dem Ziel!"));
+  }
+}
 
-  // Configuring TEXT mode
-  mySerial.println("AT+CMGF=1");
-  updateSerial();
+/**
+ * @param  messageCode The given message code
+ * @return Returns true if the message is a failure of the hardware.
+ */
+boolean isFailureAlert(int messageCode) {
+  return messageCode == MSG_SENSOR_FAILURE || messageCode == MSG_RTC_FAILURE;
+}
 
-  // Command to write a sms
-  mySerial.print("AT+CMGS=\"");
-  mySerial.print(number);
-  mySerial.println("\"");
-  updateSerial();
-  mySerial.print(createMessage(messageCode));
-  updateSerial();
+/**
+ * @param  messageCode The given message code
+ * @return Returns true if an undelivered message has to be sent again.
+ */
+boolean isCriticalAlert(int messageCode) {
+  return (messageCode >= MSG_LEVEL_1_REACHED
+      && messageCode <= MSG_LEVEL_3_REACHED) || isFailureAlert(messageCode);
+}
 
-  // HEX-Code of the char the SIM800L needs to know the end of the sms
-  mySerial.write(26);
+/**
+ * @param  alert Given alert
+ * @return Returns the index of the first recipient of the alert.
+ */
+uint8_t firstRecipient(const QueuedAlert &alert) {
+  if (alert.target != ALL_RECIPIENTS) {
+    return alert.target;
+  }
+  return 0;
 }
 
 /**
- * Sends a sms given by the message code to all given numbers.
- * @param messageCode The given message code.
+ * Returns the end of the recipients of an alert, failures of the hardware
+ * are only sent to the admin (the first number).
+ * @param  alert Given alert
+ * @return Returns the index behind the last recipient.
  */
-void warnAll(int messageCode) {
-  for (int i = 0; i < SIZE_OF_ALLOWED_NUMBERS; i++) {
-    sendingSMS(allowedNumbers[i], messageCode);
+uint8_t endRecipient(const QueuedAlert &alert) {
+  if (alert.target != ALL_RECIPIENTS) {
+    return alert.target + 1;
+  }
+  if (isFailureAlert(alert.code)) {
+    return 1;
   }
+  return RECIPIENT_COUNT;
 }
 
 /**
- * Method which provides the initializing the connection to the GPRS-Network
- * (mobile network).
+ * Starts to wait for the status report of the sms which was just sent. If no
+ * slot is free, e.g. when the level rises fast through the critical points,
+ * the sms takes over the slot of the oldest sms to the same recipient, it
+ * tells the current state anyway.
+ * @param alert         Given alert of the sms
+ * @param index         Given index of the recipient
+ * @param previousLevel Critical point the recipient was told about before
  */
-void initGPRS() {
+void trackDelivery(const QueuedAlert &alert, uint8_t index,
+    uint8_t previousLevel) {
+  uint8_t slot = DELIVERY_SLOTS;
+  for (uint8_t i = 0; i < DELIVERY_SLOTS; i++) {
+    if (deliveries[i].recipient == NO_RECIPIENT) {
+      slot = i;
+      break;
+    }
+    if (deliveries[i].recipient == index && (slot == DELIVERY_SLOTS
+        || (long) (deliveries[i].sent - deliveries[slot].sent) < 0)) {
+      slot = i;
+    }
+  }
+  if (slot == DELIVERY_SLOTS) {
+    deliveryStats[index].unconfirmed++;
+    return;
+  }
 
-  // Configure the module for GPRS connection
-  mySerial.println("AT+SAPBR=3,1,\"Contype\",\"GPRS\"");
-  updateSerial();
-  delay(500);
+  // The report of the older sms isn't awaited any longer
+  if (deliveries[slot].recipient == index) {
+    deliveryStats[index].unconfirmed++;
+  }
+  Delivery &delivery = deliveries[slot];
+  delivery.reference = modem.smsReference();
+  delivery.recipient = index;
+  delivery.code = alert.code;
+  delivery.attempt = alert.attempt;
+  delivery.previousLevel = previousLevel;
+  delivery.crossed = alert.crossed;
+  delivery.sent = millis();
+}
 
-  // Access data for the APN (needed for GPRS connection)
-  mySerial.println("AT+CSTT=\"internet.t-mobile\",\"t-mobile\",\"tm\"");
-  updateSerial();
-  delay(500);
+/**
+ * Handles a sms which the network failed to deliver. The recipient is
+ * treated as not told, a critical alert is sent again and, if that fails as
+ * well, a failure of the hardware is escalated to the next recipient. A level
+ * alert is sent again with the current state, or not at all if the recipient
+ * was told about that state in the meantime.
+ * @param delivery Given delivery
+ */
+void deliveryFailed(const Delivery &delivery) {
+  uint8_t index = delivery.recipient;
+  Serial.print(F("SMS nicht zugestellt an Empfänger "));
+  Serial.println(index);
+  deliveryStats[index].failed++;
+  if (isLevelAlert(delivery.code)
+      && notifiedLevel[index] == alertLevel(delivery.code)) {
+    notifiedLevel[index] = delivery.previousLevel;
+  }
+  if (!isCriticalAlert(delivery.code)) {
+    return;
+  }
+  MessageCode code = (MessageCode) delivery.code;
+  if (isLevelAlert(code)) {
+    uint8_t level = currentLevel();
+    if (level <= notifiedLevel[index]) {
+      return;
+    }
+    code = (MessageCode) (MSG_LEVEL_1_REACHED + level - 1);
+  }
+  if (delivery.attempt < DELIVERY_RETRIES) {
+    queueAlert(code, delivery.crossed, index, delivery.attempt + 1);
+  } else if (delivery.attempt == DELIVERY_RETRIES
+      && isFailureAlert(delivery.code)) {
+    queueAlert((MessageCode) delivery.code, delivery.crossed,
+        (index + 1) % RECIPIENT_COUNT, delivery.attempt + 1);
+  }
+}
 
-  // Command for connecting to the GPRS network
-  mySerial.println("AT+SAPBR=1,1");
-  updateSerial();
-  delay(3000);
+/**
+ * Matches the received status reports to the sent sms and gives up waiting
+ * for reports after DELIVERY_TIMEOUT ms.
+ */
+void checkDeliveries() {
+  StatusReport report;
+  while (modem.nextStatusReport(report)) {
+    for (uint8_t i = 0; i < DELIVERY_SLOTS; i++) {
+      Delivery &delivery = deliveries[i];
+      if (delivery.recipient == NO_RECIPIENT
+          || delivery.reference != report.reference) {
+        continue;
+      }
 
-  /*
-   * Command to check if we already got a ip (if this isn't executed some weird
-   * failures occurs)
-   */
-  mySerial.println("AT+SAPBR=2,1");
-  updateSerial();
-  delay(2000);
+      // The network is still trying to deliver the sms
+      if (report.status >= 0x20 && report.status < 0x40) {
+        break;
+      }
+      if (report.status < 0x20) {
+        DeliveryStats &stats = deliveryStats[delivery.recipient];
+        long latency = (millis() - delivery.sent) / 1000;
+        if (stats.delivered < 0xFF) {
+          stats.delivered++;
+        }
+        stats.latency += (latency - stats.latency) / stats.delivered;
+      } else {
+        deliveryFailed(delivery);
+      }
+      delivery.recipient = NO_RECIPIENT;
+      break;
+    }
+  }
+  for (uint8_t i = 0; i < DELIVERY_SLOTS; i++) {
+    Delivery &delivery = deliveries[i];
+    if (delivery.recipient != NO_RECIPIENT
+        && millis() - delivery.sent >= DELIVERY_TIMEOUT) {
+      deliveryStats[delivery.recipient].unconfirmed++;
+      delivery.recipient = NO_RECIPIENT;
+    }
+  }
+}
+
+/**
+ * Returns the message a recipient gets for the current alert. Level alerts
+ * are turned into the current state compared to what the recipient was told
+ * last: escalations are always sent, everything else is rate limited per
+ * recipient. A message which is held back by the limit is marked, so the
+ * recipient gets the current state once the limit allows it again.
+ * @param  messageCode Given message code of the alert
+ * @param  index       Given index of the recipient
+ * @return Returns the message code or NO_MESSAGE.
+ */
+int recipientMessage(int messageCode, uint8_t index) {
+  if (!isLevelAlert(messageCode)) {
+    return messageCode;
+  }
+  uint8_t level = alertLevel(messageCode);
+  uint8_t notified = notifiedLevel[index];
+  clearHeldBack[index] = false;
+  if (level > notified) {
+    return MSG_LEVEL_1_REACHED + level - 1;
+  }
+  if (level == notified) {
+    return NO_MESSAGE;
+  }
+  if (!smsBuckets[index].take()) {
+    Serial.print(F("SMS-Limit erreicht für "));
+    Serial.println(recipient.number);
+    clearHeldBack[index] = true;
+    return NO_MESSAGE;
+  }
+
+  // The highest critical point which isn't reached anymore
+  return MSG_LEVEL_1_CLEARED + level;
+}
+
+/**
+ * Queues the current state for the recipients whose message about a cleared
+ * critical point was held back by the rate limit, as soon as the limit
+ * allows one more sms to them.
+ */
+void sendHeldBack() {
+  for (uint8_t i = 0; i < RECIPIENT_COUNT; i++) {
+    if (!clearHeldBack[i] || alertCount == ALERT_QUEUE_SIZE
+        || !smsBuckets[i].available()) {
+      continue;
+    }
+    clearHeldBack[i] = false;
+    uint8_t level = currentLevel();
+    if (level < notifiedLevel[i]) {
+      queueAlert((MessageCode) (MSG_LEVEL_1_CLEARED + level), millis(), i);
+    }
+  }
+}
+
+/**
+ * Protothread which sends the oldest queued sms alert to its recipients.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING until the alert was sent.
+ */
+uint8_t alertFlow(Pt *pt) {
+  PT_BEGIN(pt);
+  alertInFlight = true;
+  PT_SPAWN(pt, &driverState, modem.wake(&driverState));
+  for (recipientIndex = firstRecipient(alertQueue[0]);
+      recipientIndex < endRecipient(alertQueue[0]); recipientIndex++) {
+    if (!loadRecipient(recipientIndex, recipient)) {
+      continue;
+    }
+    smsCode = recipientMessage(alertQueue[0].code, recipientIndex);
+    if (smsCode == NO_MESSAGE) {
+      continue;
+    }
+    smsStart = millis();
+    PT_SPAWN(pt, &driverState, modem.sendSms(&driverState, recipient.number,
+        writeSmsText));
+    if (!modem.result()) {
+      Serial.print(F("SMS nicht gesendet an "));
+      Serial.println(recipient.number);
+    } else {
+      recordAlertLatency();
+      trackDelivery(alertQueue[0], recipientIndex,
+          notifiedLevel[recipientIndex]);
+      if (isLevelAlert(alertQueue[0].code)) {
+        notifiedLevel[recipientIndex] = alertLevel(alertQueue[0].code);
+      }
+    }
+  }
+  memmove(alertQueue, alertQueue + 1, --alertCount * sizeof(QueuedAlert));
+  alertInFlight = false;
+  if (!modemWanted()) {
+    PT_SPAWN(pt, &driverState, modem.sleep(&driverState));
+  }
+  PT_END(pt);
+}
+
+/**
+ * Prepares the answer to the received sms, the keyword tells its language.
+ * @return Returns false if the sms isn't a query for the level or its sender
+ *         can't be answered.
+ */
+boolean prepareAnswer() {
+  if (!isReplyNumber(recipient.number)) {
+    return false;
+  }
+  int language = parseQuery(queryText);
+  if (language == NO_QUERY) {
+    return false;
+  }
+  recipient.language = language;
+  smsCode = MSG_LEVEL;
+  return true;
+}
+
+/**
+ * Protothread which answers a received sms. Residents ask for the current
+ * level with the keyword of their language, the answer is taken from the last
+ * messurement, so a flood of queries costs no extra messurement. All answers
+ * share one rate limit, so a spike of queries can neither use up the credit
+ * of the SIM nor hold back the alerts, which are sent first anyway. Other sms
+ * are deleted unanswered. Every way out puts the module back to sleep.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING until the sms was handled.
+ */
+uint8_t queryFlow(Pt *pt) {
+  PT_BEGIN(pt);
+  modem.nextIncomingSms(queryIndex);
+  PT_SPAWN(pt, &driverState, modem.wake(&driverState));
+  PT_SPAWN(pt, &driverState, modem.readSms(&driverState, queryIndex,
+      recipient.number, NUMBER_SIZE, queryText, QUERY_TEXT_SIZE));
+  if (modem.result() && prepareAnswer()) {
+    if (queryBucket.take()) {
+      PT_SPAWN(pt, &driverState, modem.sendSms(&driverState,
+          recipient.number, writeSmsText));
+      if (!modem.result()) {
+        Serial.print(F("SMS nicht gesendet an "));
+        Serial.println(recipient.number);
+      }
+    } else {
+      Serial.println(F("Zu viele Anfragen, SMS nicht beantwortet"));
+    }
+  }
+  if (!modemWanted()) {
+    PT_SPAWN(pt, &driverState, modem.sleep(&driverState));
+  }
+  PT_END(pt);
+}
+
+/**
+ * Takes the offset of the upload slot if the server assigned one in its
+ * response, it's kept in the EEPROM from now on.
+ */
+void takeSlotAssignment() {
+  uint16_t offset = parseSlotOffset(serverResponse);
+  if (offset == NO_SLOT || offset == assignedSlot) {
+    return;
+  }
+  if (saveSlotOffset(offset)) {
+    assignedSlot = offset;
+    Serial.print(F("Neuer Upload-Slot s:"));
+    Serial.println(offset);
+  }
+}
+
+/**
+ * @return Returns the number of the oldest pending readings which were
+ *         already sent by sms.
+ */
+uint8_t smsSkip() {
+  int16_t skip = smsSequence - readingLog.firstSequence();
+  return skip > 0 ? min(skip, readingLog.pending()) : 0;
+}
+
+/**
+ * @return Returns true if enough new readings are pending to send them by sms
+ *         to the gateway of the server.
+ */
+boolean fallbackDue() {
+  return Station::DATA_SMS_READINGS > 0
+      && readingLog.pending() - smsSkip() >= Station::DATA_SMS_READINGS;
+}
+
+/**
+ * Records that the current attempt didn't reach the server, its time counts
+ * as wasted.
+ */
+void recordLinkFailure() {
+  linkBreaker.failed();
+  linkStats.failures++;
+  linkStats.wastedSeconds += (millis() - attemptStart) / 1000;
+  if (linkBreaker.state() == BREAKER_OPEN) {
+    Serial.println(F("Verbindung gestoert, Uploads ausgesetzt"));
+  }
+  fallbackPending = fallbackDue();
+}
+
+/**
+ * Appends the current reading to the log, along with the trend of the supply
+ * voltage since the last upload, the temperature and the self-diagnostics.
+ */
+void logReading() {
+  Reading reading;
+  reading.time = rtc.now().unixtime();
+  reading.level = messuredHeigth;
+  reading.vcc = power.trendAvg();
+  reading.vmin = power.trendMin();
+  reading.vmax = power.trendMax();
+  reading.temperature = rtc.temperature() / 4;
+  reading.diagnostics = alertLatency.violated() ? DIAG_ALERT_SLO : 0;
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    if (sensors[i] != NULL) {
+      reading.diagnostics |= sensors[i]->anomalies() << DIAG_ANOMALY_SHIFT;
+    }
+  }
+  reading.alertP50 = alertLatency.percentile(50);
+  reading.alertP95 = alertLatency.percentile(95);
+  readingLog.append(reading);
+}
+
+/**
+ * Logs the current reading and queues an upload of the pending readings. The
+ * readings are only logged here, on the schedule of the messurement, so an
+ * upload which is repeated (e.g. after backpressure of the server) doesn't
+ * push the oldest pending reading out of the log.
+ */
+void queueUpload() {
+  logReading();
+  uploadPending = true;
+}
+
+/**
+ * Copies the current statistics for the body of an upload or a data sms.
+ */
+void takeBodyStats() {
+  memcpy(bodyStats.delivery, deliveryStats, sizeof(deliveryStats));
+  for (uint8_t i = 0; i < AT_STEP_COUNT; i++) {
+    bodyStats.at[i] = modem.stats((AtStep) i);
+  }
+  bodyStats.link = linkStats;
+}
+
+/**
+ * Writes the body of an upload as compact binary payload to the given output.
+ * The statistics are the ones taken when the upload started.
+ * @param out Given output
+ */
+void writeUploadBody(Print &out) {
+  writeBatchHeader(out, Station::STATION_ID, readingLog.firstSequence(),
+      uploadCount);
+  readingLog.write(out, uploadCount);
+  writeDeliveryStats(out, bodyStats.delivery, RECIPIENT_COUNT);
+  writeAtStats(out, bodyStats.at, uploadAtStats ? AT_STEP_COUNT : 0);
+  writeLinkStats(out, bodyStats.link);
+}
+
+/**
+ * Writes the body of a data sms to the given output, it's the same payload as
+ * the one of an upload, but only with the readings which weren't sent by sms
+ * yet and without the statistics which are reset by an upload.
+ * @param out Given output
+ */
+void writeSmsBody(Print &out) {
+  writeBatchHeader(out, Station::STATION_ID,
+      readingLog.firstSequence() + smsSkip(), smsCount);
+  readingLog.write(out, smsCount, smsSkip());
+  writeDeliveryStats(out, bodyStats.delivery, 0);
+  writeAtStats(out, bodyStats.at, 0);
+  writeLinkStats(out, bodyStats.link);
+}
+
+/**
+ * Writes the URL of the server to the given output.
+ * @param out Given output
+ */
+void writeUrl(Print &out) {
+  out.print(Station::serverUrl());
+  out.print(Station::serverPw());
+}
+
+/**
+ * Protothread which transfers the readings of an upload to the server and
+ * keeps the outcome in serverReached and uploadAccepted. There's one
+ * specialization per transport and just the one of the profile is spawned,
+ * so the flows of the other transport aren't linked into the station.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING until the transfer ended.
+ */
+template <bool coap>
+uint8_t transferUpload(Pt *pt);
+
+/**
+ * Transfers the readings with a confirmable CoAP POST request.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING until the transfer ended.
+ */
+template <>
+inline uint8_t transferUpload<true>(Pt *pt) {
+  PT_BEGIN(pt);
+  PT_SPAWN(pt, &driverState, modem.udpOpen(&driverState,
+      Station::coapHost(), Station::COAP_SERVER_PORT));
+  if (modem.result()) {
+    PT_SPAWN(pt, &driverState, coap.post(&driverState, "r",
+        writeUploadBody));
+    Serial.print(F("CoAP Status:"));
+    Serial.println(coap.result());
+    Serial.print(F("CoAP Bytes:"));
+    Serial.print(coap.bytes());
+    Serial.print(F(" Round Trips:"));
+    Serial.println(coap.roundTrips());
+    serverReached = coap.result() != -1;
+    uploadAccepted = coap.result() / 100 == 2;
+    if (coap.result() == COAP_SERVICE_UNAVAILABLE) {
+      deferUpload(min(coap.maxAge(), BACKOFF_MAX / 1000) * 1000);
+    }
+    if (uploadAccepted) {
+      coap.responseText(serverResponse, RESPONSE_SIZE);
+      takeSlotAssignment();
+    }
+  } else {
+    Serial.println(F("Keine Verbindung zum Server"));
+  }
+  PT_SPAWN(pt, &driverState, modem.udpClose(&driverState));
+  PT_END(pt);
 }
 
 /**
- * Method which provides the initializing of HTTP and SSL.
+ * Transfers the readings with a HTTP POST request.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING until the transfer ended.
  */
-void initHTTP() {
-  mySerial.println("AT+HTTPINIT");
-  updateSerial();
-  delay(500);
-  mySerial.println("AT+HTTPSSL=1");
-  updateSerial();
-  delay(500);
+template <>
+inline uint8_t transferUpload<false>(Pt *pt) {
+  PT_BEGIN(pt);
+  PT_SPAWN(pt, &driverState, modem.connect(&driverState));
+  if (modem.result()) {
+
+    // Write URL to the module
+    writeUrl(modem.beginUrl());
+    PT_SPAWN(pt, &driverState, modem.endUrl(&driverState));
+    if (modem.result()) {
+
+      // Establish the HTTP connection
+      PT_SPAWN(pt, &driverState, modem.httpPost(&driverState,
+          writeUploadBody));
 
-  // Set user ID to 1 (Needed HTTP param)
-  mySerial.println("AT+HTTPPARA=\"CID\",1");
-  updateSerial();
-  delay(500);
+      // Codes from 600 on are network errors reported by the module itself
+      serverReached = modem.result() >= 100 && modem.result() < 600;
+    }
+    Serial.print(F("HTTP Status:"));
+    Serial.println(modem.result());
+    uploadAccepted = modem.result() / 100 == 2;
+    if (modem.result() == HTTP_TOO_MANY_REQUESTS
+        || modem.result() == HTTP_SERVICE_UNAVAILABLE) {
+      deferUpload(0);
+    }
+    if (uploadAccepted && modem.responseLength() > 0) {
+      PT_SPAWN(pt, &driverState, modem.httpRead(&driverState,
+          serverResponse, RESPONSE_SIZE));
+      if (modem.result()) {
+        takeSlotAssignment();
+      }
+    }
+  } else {
+    Serial.println(F("Keine Verbindung zum Server"));
+  }
+  PT_SPAWN(pt, &driverState, modem.disconnect(&driverState));
+  PT_END(pt);
 }
 
 /**
- * Method which terminates SSL, HTTP and the mobile network.
+ * Protothread which provides the sending of the water heigth to the server.
+ * The oldest readings which the server didn't acknowledge yet are sent as
+ * compact binary payload, with a HTTP POST request or a confirmable CoAP POST
+ * request. They're only dropped from the log once the server accepted them.
+ * If the supply is critical nothing is sent, so the remaining energy is left
+ * for the sms alerts. If the server wasn't reached several times in a row,
+ * the uploads are suspended by a circuit breaker and the readings pile up in
+ * the log. When the backoff ran out, a cheap check of the registration in
+ * the network comes first, the trial upload only follows if it's passed.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING until the upload ended.
  */
-void terminateConnection() {
-  mySerial.println("AT+HTTPTERM");
-  updateSerial();
-  delay(500);
+uint8_t uploadFlow(Pt *pt) {
+  PT_BEGIN(pt);
+  uploadPending = false;
+  if (power.state() == POWER_CRITICAL) {
+    Serial.println(F("Versorgung kritisch, keine Daten gesendet"));
+    PT_EXIT(pt);
+  }
+  if (!linkBreaker.allow()) {
+    fallbackPending = fallbackDue();
+    PT_EXIT(pt);
+  }
+  attemptStart = millis();
+  serverReached = false;
+  PT_SPAWN(pt, &driverState, modem.wake(&driverState));
+  if (!modem.result()) {
+    Serial.println(F("Modul antwortet nicht"));
+    recordLinkFailure();
+    PT_EXIT(pt);
+  }
+  if (linkBreaker.state() == BREAKER_HALF_OPEN) {
+    PT_SPAWN(pt, &driverState, modem.checkNetwork(&driverState));
+    if (!modem.result()) {
+      Serial.println(F("Nicht im Netz eingebucht"));
+      recordLinkFailure();
+      PT_EXIT(pt);
+    }
+  }
+  uploadCount = min(readingLog.pending(), LOG_BATCH);
+  uploadAtStats = atStatsAge >= Station::AT_STATS_UPLOADS;
+  takeBodyStats();
+
+  modem.resetRoundTrips();
+  uploadAccepted = false;
+  PT_SPAWN(pt, &transferState,
+      transferUpload<Station::UPLOAD_COAP>(&transferState));
+  if (serverReached) {
+    linkBreaker.succeeded();
+  } else {
+    recordLinkFailure();
+  }
+  Serial.print(F("Gemessener Stand:"));
+  Serial.println(messuredHeigth);
+  Serial.print(F("I2C Transaktionen:"));
+  Serial.println(rtc.transactions());
+  Serial.print(F("AT Round Trips:"));
+  Serial.println(modem.roundTrips());
+  if (uploadAccepted) {
+    readingLog.acknowledge(uploadCount);
+    fallbackPending = false;
 
-  // Command to disconnect from the GPRS network
-  mySerial.println("AT+SAPBR=0,1");
-  updateSerial();
-  delay(500);
+    // Readings left over from an outage are sent with the next batch at once
+    if (readingLog.pending() > 0) {
+      uploadPending = true;
+    }
+    uploadBackoff = 0;
+    power.resetTrend();
+    alertLatency.resetViolated();
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+      if (sensors[i] != NULL) {
+        sensors[i]->resetAnomalies();
+      }
+    }
+    memset(deliveryStats, 0, sizeof(deliveryStats));
+  }
+  if (uploadAccepted && uploadAtStats) {
+    atStatsAge = 0;
+  } else if (atStatsAge < Station::AT_STATS_UPLOADS) {
+    atStatsAge++;
+  }
+  if (!modemWanted()) {
+    PT_SPAWN(pt, &driverState, modem.sleep(&driverState));
+  }
+  PT_END(pt);
 }
 
 /**
- * Method which provides the sending of the water heigth to the server.
+ * Protothread which sends the readings by sms to the gateway of the server
+ * while the data connection fails, e.g. when GPRS is down in a storm but GSM
+ * still works. The readings stay in the log, they're uploaded once the
+ * connection is back and the server drops the ones it got by sms already.
+ * Nothing is sent if an upload took the readings in the meantime.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING until the sms was sent.
  */
-void sendDataToServer() {
-  initGPRS();
-  initHTTP();
+uint8_t fallbackFlow(Pt *pt) {
+  PT_BEGIN(pt);
+  fallbackPending = false;
+  if (readingLog.pending() == smsSkip()) {
+    PT_EXIT(pt);
+  }
+  PT_SPAWN(pt, &driverState, modem.wake(&driverState));
+  if (!modem.result()) {
+    Serial.println(F("Modul antwortet nicht"));
+    PT_EXIT(pt);
+  }
+  smsCount = min(readingLog.pending() - smsSkip(), LOG_BATCH);
+  takeBodyStats();
+  smsParts = (measureBody(writeSmsBody) + SMS_PART_SIZE - 1) / SMS_PART_SIZE;
+  smsReference++;
+  for (smsPart = 0; smsPart < smsParts; smsPart++) {
+    PT_SPAWN(pt, &driverState, modem.sendDataSms(&driverState,
+        Station::gatewayNumber(), writeSmsBody, smsReference, smsPart));
+    if (!modem.result()) {
+      break;
+    }
+  }
+  Serial.print(F("Daten-SMS Teile:"));
+  Serial.print(smsPart);
+  Serial.print('/');
+  Serial.println(smsParts);
+  if (smsPart == smsParts) {
+    smsSequence = readingLog.firstSequence() + smsSkip() + smsCount;
+  }
+  if (!modemWanted()) {
+    PT_SPAWN(pt, &driverState, modem.sleep(&driverState));
+  }
+  PT_END(pt);
+}
 
-  // Command to write URL with sensor data to the module
-  mySerial.print("AT+HTTPPARA=\"URL\",\"");
-  mySerial.print(SERVER_URL);
-  mySerial.print(SERVER_PW);
-  mySerial.print(messuredHeigth);
-  mySerial.println("\"");
-  updateSerial();
-  delay(500);
+/**
+ * Protothread which drives the module, queued sms alerts are sent before the
+ * answers to received sms and those before a pending upload. An upload waits
+ * as long as the server asks to hold off. Readings which couldn't be uploaded
+ * are sent by sms last.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING all the time.
+ */
+uint8_t modemThread(Pt *pt) {
+  PT_BEGIN(pt);
+  while (true) {
+    PT_WAIT_UNTIL(pt, modemWanted());
+    modemBusy = true;
+    if (alertCount > 0) {
+      PT_SPAWN(pt, &flowState, alertFlow(&flowState));
+    } else if (modem.smsWaiting()) {
+      PT_SPAWN(pt, &flowState, queryFlow(&flowState));
+    } else if (uploadDue()) {
+      PT_SPAWN(pt, &flowState, uploadFlow(&flowState));
+    } else {
+      PT_SPAWN(pt, &flowState, fallbackFlow(&flowState));
+    }
+    modemBusy = false;
+  }
+  PT_END(pt);
+}
 
-  // Establish the HTTP connection
-  mySerial.println("AT+HTTPACTION=0");
-  updateSerial();
-  delay(5000);
-  updateSerial();
-  Serial.print("Gemessener Stand:");
-  Serial.println(sonar.ping_cm());
-  terminateConnection();
+/**
+ * Queues an upload for the crossing of a critical point, unless the crossings
+ * already used up their share of uploads. The reading is logged with the next
+ * scheduled upload then, so a level flapping around a point doesn't wear out
+ * the EEPROM.
+ */
+void queueCrossingUpload() {
+  if (crossingUploads.take()) {
+    queueUpload();
+  }
 }
 
 /**
- * Check the water height if a critical point is reached, if so send a sms
- * warning and data to the server. Also it inform via sms if the water is back
- * again under a certain critical point.
+ * Check the water height if a critical point is reached, if so queue a sms
+ * warning and an upload of the data to the server. Also it inform via sms if
+ * the water is back again under a certain critical point, a point only
+ * counts as cleared once the water fell LEVEL_HYSTERESIS below it.
  */
 void checkWaterHeight() {
   Serial.println(messuredHeigth);
-  if (messuredHeigth <= CRIT_DIST_3 && !warning3Sent) {
-    Serial.println(createMessage(3));
-    warnAll(3);
-    delay(10000);
-    sendDataToServer();
+  if (messuredHeigth >= Station::CRIT_LEVEL_3 && !warning3Sent) {
+    queueAlert(MSG_LEVEL_3_REACHED, sampleStart);
+    queueCrossingUpload();
     warning3Sent = true;
-  } else if (messuredHeigth <= CRIT_DIST_2 && !warning2Sent) {
-    Serial.println(createMessage(2));
-    warnAll(2);
-    delay(10000);
-    sendDataToServer();
+  } else if (messuredHeigth >= Station::CRIT_LEVEL_2 && !warning2Sent) {
+    queueAlert(MSG_LEVEL_2_REACHED, sampleStart);
+    queueCrossingUpload();
     warning2Sent = true;
-  } else if (messuredHeigth <= CRIT_DIST_1 && !warning1Sent) {
-    Serial.println(createMessage(1));
-    warnAll(1);
-    delay(10000);
-    sendDataToServer();
+  } else if (messuredHeigth >= Station::CRIT_LEVEL_1 && !warning1Sent) {
+    queueAlert(MSG_LEVEL_1_REACHED, sampleStart);
+    queueCrossingUpload();
     warning1Sent = true;
-  } else if (messuredHeigth > CRIT_DIST_3 && warning3Sent) {
-    Serial.println(createMessage(6));
-    warnAll(6);
-    delay(10000);
-    sendDataToServer();
+  } else if (warning3Sent
+      && messuredHeigth < Station::CRIT_LEVEL_3 - Station::LEVEL_HYSTERESIS) {
+    queueAlert(MSG_LEVEL_3_CLEARED, sampleStart);
+    queueCrossingUpload();
     warning3Sent = false;
-  }else if (messuredHeigth > CRIT_DIST_2 && warning2Sent) {
-    Serial.println(createMessage(5));
-    warnAll(5);
-    delay(10000);
-    sendDataToServer();
+  } else if (warning2Sent
+      && messuredHeigth < Station::CRIT_LEVEL_2 - Station::LEVEL_HYSTERESIS) {
+    queueAlert(MSG_LEVEL_2_CLEARED, sampleStart);
+    queueCrossingUpload();
     warning2Sent = false;
-  }else if (messuredHeigth > CRIT_DIST_1 && warning1Sent) {
-    Serial.println(createMessage(4));
-    warnAll(4);
-    delay(10000);
-    sendDataToServer();
+  } else if (warning1Sent
+      && messuredHeigth < Station::CRIT_LEVEL_1 - Station::LEVEL_HYSTERESIS) {
+    queueAlert(MSG_LEVEL_1_CLEARED, sampleStart);
+    queueCrossingUpload();
     warning1Sent = false;
   }
 }
 
 
+/**
+ * Seeds random() once, so the stations don't share the jitter of their
+ * uploads and the ids of their CoAP messages after a common power failure.
+ * Mixes the id of the station, the noise of the floating input and the time
+ * of the rtc module.
+ */
+void seedRandom() {
+  uint32_t seed = Station::STATION_ID;
+  for (uint8_t i = 0; i < 32; i++) {
+    seed = (seed << 1 | seed >> 31) ^ analogRead(SEED_PIN);
+  }
+  randomSeed(seed ^ rtc.now().unixtime());
+}
+
 /**
  * Setup which needs to be done before the loop can start.
  */
@@ -313,51 +1408,173 @@ void setup() {
   //Begin serial communication with Arduino and SIM800L
   mySerial.begin(9600);
 
-  // Configure the SIM800L to show the number of a caller
-  //mySerial.println("AT+CLIP=1");
-  updateSerial();
+  // Give the module time to register in the network
   delay(10000);
+  PT_RUN(modem.begin(&driverState));
+  if (!modem.result()) {
+    Serial.println(F("Modul antwortet nicht"));
+  }
+
+  for (uint8_t i = 0; i < DELIVERY_SLOTS; i++) {
+    deliveries[i].recipient = NO_RECIPIENT;
+  }
 
-  // If rtc module isn't working stop Arduino and send a sms to inform the admin
+  // Recover the readings which the server didn't acknowledge before the reset
+  readingLog.recover();
+
+  // None of the recovered readings is known to have been sent by sms
+  smsSequence = readingLog.firstSequence();
+  Serial.print(F("Gespeicherte Messungen:"));
+  Serial.println(readingLog.pending());
+  assignedSlot = loadSlotOffset();
+
+  // Load the conversion of the messured distances into water levels
+  if (!loadCalibration(Station::SENSOR_LEVEL)) {
+    Serial.println(F("Keine Kalibrierung gefunden, nutze Standardwerte"));
+  }
+
+  /*
+   * If rtc module isn't working stop messuring and send a sms to inform the
+   * admin
+   */
   if (! rtc.begin()) {
-    sendingSMS(allowedNumbers[0], 8);
-    updateSerial();
-    while (1);
+    queueAlert(MSG_RTC_FAILURE, millis());
+    halted = true;
+    return;
+  }
+  seedRandom();
+  coap.begin();
+  if (rtc.lostPower()) {
+    Serial.println(F("RTC-Modul hat die Zeit verloren, bitte stellen!"));
   }
 }
 
 /**
- * Main function of the program.
+ * Evaluates the fused readings of the sensors: checks the critical points and
+ * the upload slot, or the failure of all sensors.
  */
-void loop() {
-  messuredHeigth = sonar.ping_cm();
+void evaluateMessurement() {
+  int fusedDistance = fuseSensors(sensors, SENSOR_COUNT);
   long currentMillis = millis();
-  Serial.println(messuredHeigth);
+  Serial.println(fusedDistance);
 
-  // Check if sensor getting no wrong values
-  if (messuredHeigth > MIN_DIST && messuredHeigth < MAX_DIST) {
+  // Check if at least one sensor is getting no wrong values
+  if (fusedDistance != INVALID_DIST) {
+    messuredDistance = (fusedDistance + MM_PER_CM / 2) / MM_PER_CM;
+    messuredHeigth = distanceToLevel(messuredDistance);
     messureFail = false;
     previousMillis = currentMillis;
     checkWaterHeight();
 
-    // Send data every 10 minutes.
-    DateTime now = rtc.now();
-    if ((now.minute() % 10 == 0) && (!dataSent)) {
-      sendDataToServer();
-      dataSent = true;
-    } else if (now.minute() % 10 != 0) {
-      dataSent = false;
+    /*
+     * Send data every 10 minutes (less often if the supply is low), in the
+     * slot of the station, so a fleet doesn't send all at the same second
+     */
+    uint8_t period = Station::UPLOAD_PERIOD;
+    if (power.state() != POWER_NORMAL) {
+      period = Station::UPLOAD_PERIOD_LOW;
+    }
+    uint16_t periodS = period * 60;
+    uint16_t offset = slotOffset(Station::STATION_ID, assignedSlot, periodS);
+    rtc.setSlot(period, (offset + uploadJitter) % periodS);
+    uint32_t elapsed = rtc.now().unixtime() - offset;
+    uint16_t phase = elapsed % periodS;
+    if (elapsed / periodS != lastSlot && phase >= uploadJitter
+        && phase < uploadJitter + 60) {
+      queueUpload();
+      lastSlot = elapsed / periodS;
+      uploadJitter = random(Station::UPLOAD_JITTER_S + 1);
     }
 
   /*
-   * Sensor delivering wrong values for INTERVAL ms, so inform admin and stop
-   * program
+   * All sensors delivering wrong values for INTERVAL ms, so inform admin and
+   * stop messuring
    */
-  } else if (currentMillis - previousMillis >= INTERVAL && messureFail) {
-    sendingSMS(allowedNumbers[0], 7);
-    while (1);
+  } else if (currentMillis - previousMillis >= Station::INTERVAL
+      && messureFail) {
+    queueAlert(MSG_SENSOR_FAILURE, sampleStart);
+    halted = true;
   } else {
     messureFail = true;
   }
-  delay(500);
+}
+
+/**
+ * @return Returns the time in ms between two messurements.
+ */
+unsigned long sampleDelay() {
+  if (power.state() == POWER_NORMAL) {
+    return Station::SAMPLE_DELAY;
+  }
+  return Station::SAMPLE_DELAY_LOW;
+}
+
+/**
+ * Checks if the module sent something while the current reading was taken.
+ * The receive interrupt of the software serial blocks the other interrupts
+ * for about 1 ms per byte at 9600 baud, so the timer of micros() stalls and
+ * the timing of an echo is off by up to 17 cm.
+ * @return Returns true if the reading is disturbed.
+ */
+boolean readingDisturbed() {
+  return mySerial.available() != rxWaiting || mySerial.overflow();
+}
+
+/**
+ * Protothread which messures the water heigth regularly. The supply is
+ * messured along with it, so its trend contains the transmit bursts of the
+ * module as well. A reading during which the module sent something is
+ * repeated, if it's still disturbed after SENSOR_RETRIES repetitions the
+ * sensor keeps its previous reading.
+ * @param  pt Given state of the protothread
+ * @return Returns PT_WAITING all the time.
+ */
+uint8_t sampleThread(Pt *pt) {
+  PT_BEGIN(pt);
+  while (true) {
+    sampleStart = millis();
+    power.sample();
+    sensorRetries = 0;
+    for (sensorIndex = 0; sensorIndex < SENSOR_COUNT; sensorIndex++) {
+      if (sensors[sensorIndex] == NULL) {
+        continue;
+      }
+
+      // Give the echo of the previous sensor time to die out
+      PT_WAIT_UNTIL(pt, millis() - sensorStart >= SENSOR_STAGGER);
+      rxWaiting = mySerial.available();
+      rawDistance = sensors[sensorIndex]->read();
+      sensorStart = millis();
+      if (!readingDisturbed()) {
+        sensors[sensorIndex]->accept(rawDistance);
+      } else if (sensorRetries < SENSOR_RETRIES) {
+
+        // Read the same sensor again (the loop counts the index up)
+        sensorRetries++;
+        sensorIndex--;
+        continue;
+      }
+      sensorRetries = 0;
+    }
+    evaluateMessurement();
+    PT_WAIT_UNTIL(pt, millis() - sampleStart >= sampleDelay());
+  }
+  PT_END(pt);
+}
+
+/**
+ * Main function of the program.
+ */
+void loop() {
+
+  // The hand off would steal the responses of a running flow
+  if (!modemBusy) {
+    updateSerial();
+  }
+  if (!halted) {
+    sampleThread(&sampleThreadState);
+  }
+  modemThread(&modemThreadState);
+  checkDeliveries();
+  sendHeldBack();
 }
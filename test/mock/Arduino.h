@@ -0,0 +1,228 @@
+#ifndef ARDUINO_MOCK_H
+#define ARDUINO_MOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "avr/pgmspace.h"
+
+/**
+ * Minimal Arduino core for the native unit tests (pio test -e native). It
+ * covers just the part of the API the logic of the station uses. Time, the
+ * analog inputs and the port registers are plain variables, so a test sets
+ * them before calling the code under test.
+ */
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(x, low, high) \
+    ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+/**
+ * @return Returns the time in ms which millis() reports, set by the test.
+ */
+inline unsigned long &mockMillis() {
+  static unsigned long ms = 0;
+  return ms;
+}
+
+/**
+ * @return Returns the time in us which micros() reports, set by the test.
+ */
+inline unsigned long &mockMicros() {
+  static unsigned long us = 0;
+  return us;
+}
+
+/**
+ * @param  pin Given analog pin
+ * @return Returns the value analogRead() reports for the pin.
+ */
+inline int &mockAnalog(uint8_t pin) {
+  static int values[A7 + 1];
+  return values[pin];
+}
+
+// Registers of the ports (PINx, DDRx, PORTx of B, C and D)
+inline volatile uint8_t *mockRegisters() {
+  static volatile uint8_t registers[9];
+  return registers;
+}
+
+#define PINB (mockRegisters()[0])
+#define DDRB (mockRegisters()[1])
+#define PORTB (mockRegisters()[2])
+#define PINC (mockRegisters()[3])
+#define DDRC (mockRegisters()[4])
+#define PORTC (mockRegisters()[5])
+#define PIND (mockRegisters()[6])
+#define DDRD (mockRegisters()[7])
+#define PORTD (mockRegisters()[8])
+
+// Last address of the EEPROM of the ATmega328P
+#define E2END 0x3FF
+
+inline unsigned long millis() { return mockMillis(); }
+
+inline unsigned long micros() { return mockMicros(); }
+
+inline void delay(unsigned long ms) { mockMillis() += ms; }
+
+inline void delayMicroseconds(unsigned int us) { mockMicros() += us; }
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+inline int digitalRead(uint8_t) { return LOW; }
+
+inline int analogRead(uint8_t pin) { return mockAnalog(pin); }
+
+inline void randomSeed(unsigned long seed) { srand(seed); }
+
+inline long random(long howBig) { return howBig > 0 ? rand() % howBig : 0; }
+
+inline long random(long howSmall, long howBig) {
+  return howSmall + random(howBig - howSmall);
+}
+
+/**
+ * Output of chars with the formatting of the Arduino core.
+ */
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+
+  size_t write(const char *str) {
+    return write((const uint8_t *) str, strlen(str));
+  }
+
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *) buffer, size);
+  }
+
+  virtual void flush() {}
+
+  size_t print(const __FlashStringHelper *text) {
+    return write(reinterpret_cast<const char *>(text));
+  }
+
+  size_t print(const char text[]) { return write(text); }
+
+  size_t print(char c) { return write((uint8_t) c); }
+
+  size_t print(unsigned char n, int base = DEC) {
+    return print((unsigned long) n, base);
+  }
+
+  size_t print(int n, int base = DEC) { return print((long) n, base); }
+
+  size_t print(unsigned int n, int base = DEC) {
+    return print((unsigned long) n, base);
+  }
+
+  size_t print(long n, int base = DEC) {
+    if (base == DEC && n < 0) {
+      return print('-') + printNumber(-(unsigned long) n, base);
+    }
+    return printNumber(n, base);
+  }
+
+  size_t print(unsigned long n, int base = DEC) {
+    return printNumber(n, base);
+  }
+
+  size_t println() { return write("\r\n"); }
+
+  template <typename T>
+  size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+
+  template <typename T>
+  size_t println(T value, int base) {
+    size_t n = print(value, base);
+    return n + println();
+  }
+
+private:
+  size_t printNumber(unsigned long n, int base) {
+    char digits[8 * sizeof(long) + 1];
+    char *digit = &digits[sizeof(digits) - 1];
+    *digit = '\0';
+    do {
+      uint8_t value = n % base;
+      *--digit = value < 10 ? '0' + value : 'A' + value - 10;
+      n /= base;
+    } while (n > 0);
+    return write(digit);
+  }
+};
+
+/**
+ * Input of chars, implemented by the serial mocks of the tests.
+ */
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+/**
+ * Serial monitor which swallows the output of the station.
+ */
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t) { return 1; }
+  using Print::write;
+};
+
+inline HardwareSerial &mockSerial() {
+  static HardwareSerial serial;
+  return serial;
+}
+
+#define Serial (mockSerial())
+
+#endif
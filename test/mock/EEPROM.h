@@ -0,0 +1,48 @@
+#ifndef EEPROM_MOCK_H
+#define EEPROM_MOCK_H
+
+#include "Arduino.h"
+
+/**
+ * EEPROM of the native unit tests, kept in RAM. clear() sets every cell to
+ * 0xFF like a new chip.
+ */
+class EEPROMClass {
+public:
+  uint8_t read(int address) { return cells()[address]; }
+
+  void write(int address, uint8_t value) { cells()[address] = value; }
+
+  void update(int address, uint8_t value) { cells()[address] = value; }
+
+  uint16_t length() { return E2END + 1; }
+
+  template <typename T>
+  T &get(int address, T &value) {
+    memcpy(&value, cells() + address, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  const T &put(int address, const T &value) {
+    memcpy(cells() + address, &value, sizeof(T));
+    return value;
+  }
+
+  void clear() { memset(cells(), 0xFF, E2END + 1); }
+
+private:
+  static uint8_t *cells() {
+    static uint8_t data[E2END + 1];
+    return data;
+  }
+};
+
+inline EEPROMClass &mockEeprom() {
+  static EEPROMClass eeprom;
+  return eeprom;
+}
+
+#define EEPROM (mockEeprom())
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef MOCK_SERIAL_H
+#define MOCK_SERIAL_H
+
+#include "Arduino.h"
+
+// Size of the buffer for everything the station wrote to the module
+#define MOCK_SENT_SIZE 1024
+
+// Size of the buffer for the answers which wait to be read
+#define MOCK_INPUT_SIZE 256
+
+// Highest number of commands of a script
+#define MOCK_SCRIPT_SIZE 16
+
+/**
+ * Serial line of the cellular module for the native unit tests. It answers
+ * the commands of the station from a script: every line the station ends
+ * (with a line feed or the Ctrl-Z of an sms) which contains the next command
+ * of the script gets the answer of that command. Raw data without a line
+ * ending, e.g. a body after DOWNLOAD, ends up in front of the next command.
+ * Lines which don't match aren't answered, so the flow under test waits for
+ * its timeout.
+ */
+class MockSerial : public Stream {
+public:
+  MockSerial() { clear(); }
+
+  /**
+   * Forgets the script, the sent chars and the answers which wait.
+   */
+  void clear() {
+    steps = 0;
+    step = 0;
+    sentLength = 0;
+    sentText[0] = '\0';
+    lineStart = 0;
+    inputLength = 0;
+    inputRead = 0;
+  }
+
+  /**
+   * Appends a command to the script.
+   * @param command  Given part of the line sent by the station
+   * @param response Given answer of the module, including the line endings
+   */
+  void answer(const char *command, const char *response) {
+    commands[steps] = command;
+    responses[steps] = response;
+    steps++;
+  }
+
+  /**
+   * Lets the module send something without being asked, e.g. a +CDS.
+   * @param text Given text including the line endings
+   */
+  void unsolicited(const char *text) { receive(text); }
+
+  /**
+   * @return Returns true if every command of the script was answered.
+   */
+  boolean done() const { return step == steps; }
+
+  /**
+   * @return Returns everything the station wrote to the module.
+   */
+  const char *sent() const { return sentText; }
+
+  int available() { return inputLength - inputRead; }
+
+  int read() { return available() > 0 ? input[inputRead++] : -1; }
+
+  int peek() { return available() > 0 ? input[inputRead] : -1; }
+
+  size_t write(uint8_t c) {
+    if (sentLength < MOCK_SENT_SIZE - 1) {
+      sentText[sentLength++] = c;
+      sentText[sentLength] = '\0';
+    }
+    if (c == '\n' || c == 26) {
+      const char *line = sentText + lineStart;
+      if (step < steps && strstr(line, commands[step]) != NULL) {
+        receive(responses[step++]);
+      }
+      lineStart = sentLength;
+    }
+    return 1;
+  }
+
+  using Print::write;
+
+private:
+
+  /**
+   * Queues chars which the station reads next.
+   * @param text Given chars
+   */
+  void receive(const char *text) {
+    if (inputRead == inputLength) {
+      inputRead = 0;
+      inputLength = 0;
+    }
+    while (*text != '\0' && inputLength < MOCK_INPUT_SIZE) {
+      input[inputLength++] = *text++;
+    }
+  }
+
+  const char *commands[MOCK_SCRIPT_SIZE];
+  const char *responses[MOCK_SCRIPT_SIZE];
+  uint8_t steps;
+  uint8_t step;
+
+  char sentText[MOCK_SENT_SIZE];
+  uint16_t sentLength;
+  uint16_t lineStart;
+
+  char input[MOCK_INPUT_SIZE];
+  uint16_t inputLength;
+  uint16_t inputRead;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PGMSPACE_MOCK_H
+#define PGMSPACE_MOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+/**
+ * Flash access of avr-libc for the native unit tests: the host has a single
+ * address space, so the flash variants map to the plain functions.
+ */
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(address) (*(const uint8_t *) (address))
+#define pgm_read_word(address) (*(const uint16_t *) (address))
+#define pgm_read_dword(address) (*(const uint32_t *) (address))
+#define pgm_read_ptr(address) (*(const void * const *) (address))
+
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strncasecmp_P strncasecmp
+#define strstr_P strstr
+#define strspn_P strspn
+#define memcpy_P memcpy
+
+#endif
@@ -0,0 +1,102 @@
+#include <unity.h>
+#include "Calibration.h"
+#include "EEPROM.h"
+
+void setUp(void) {
+  EEPROM.clear();
+}
+
+void tearDown(void) {
+}
+
+/**
+ * Enters a table with three points and a mounting offset of 10 cm.
+ */
+static void enterTable() {
+  beginCalibration(10);
+  addCalibrationPoint(100, 400);
+  addCalibrationPoint(200, 320);
+  addCalibrationPoint(300, 180);
+}
+
+void test_point_without_begin(void) {
+  TEST_ASSERT_FALSE(addCalibrationPoint(100, 400));
+}
+
+void test_linear_default(void) {
+  TEST_ASSERT_FALSE(loadCalibration(500));
+  TEST_ASSERT_EQUAL_INT(500, distanceToLevel(0));
+  TEST_ASSERT_EQUAL_INT(380, distanceToLevel(120));
+  TEST_ASSERT_EQUAL_INT(0, distanceToLevel(500));
+  TEST_ASSERT_EQUAL_INT(-50, distanceToLevel(550));
+  TEST_ASSERT_TRUE(loadCalibration(500));
+}
+
+void test_interpolation_between_the_points(void) {
+  enterTable();
+  TEST_ASSERT_EQUAL_INT(400, distanceToLevel(90));
+  TEST_ASSERT_EQUAL_INT(360, distanceToLevel(140));
+  TEST_ASSERT_EQUAL_INT(320, distanceToLevel(190));
+  TEST_ASSERT_EQUAL_INT(250, distanceToLevel(240));
+  TEST_ASSERT_EQUAL_INT(180, distanceToLevel(290));
+}
+
+void test_extrapolation_of_the_outer_segments(void) {
+  enterTable();
+  TEST_ASSERT_EQUAL_INT(440, distanceToLevel(40));
+  TEST_ASSERT_EQUAL_INT(110, distanceToLevel(340));
+}
+
+void test_rounding_to_the_nearest_cm(void) {
+  beginCalibration(0);
+  addCalibrationPoint(0, 0);
+  addCalibrationPoint(3, 1);
+  TEST_ASSERT_EQUAL_INT(0, distanceToLevel(1));
+  TEST_ASSERT_EQUAL_INT(1, distanceToLevel(2));
+  TEST_ASSERT_EQUAL_INT(-1, distanceToLevel(-2));
+}
+
+void test_table_survives_a_reset(void) {
+  enterTable();
+  loadCalibration(500);
+  TEST_ASSERT_TRUE(loadCalibration(500));
+  TEST_ASSERT_EQUAL_INT(360, distanceToLevel(140));
+}
+
+void test_single_point_isnt_used(void) {
+  loadCalibration(500);
+  beginCalibration(10);
+  TEST_ASSERT_TRUE(addCalibrationPoint(100, 400));
+  TEST_ASSERT_EQUAL_INT(380, distanceToLevel(120));
+}
+
+void test_points_have_to_ascend(void) {
+  beginCalibration(0);
+  TEST_ASSERT_TRUE(addCalibrationPoint(100, 400));
+  TEST_ASSERT_FALSE(addCalibrationPoint(100, 390));
+  TEST_ASSERT_FALSE(addCalibrationPoint(50, 450));
+}
+
+void test_table_is_limited(void) {
+  beginCalibration(0);
+  for (uint8_t i = 0; i < CALIBRATION_POINTS; i++) {
+    TEST_ASSERT_TRUE(addCalibrationPoint(i * 10, 100 - i));
+  }
+  TEST_ASSERT_FALSE(addCalibrationPoint(CALIBRATION_POINTS * 10, 0));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  // Has to run first, before any calibration was begun
+  RUN_TEST(test_point_without_begin);
+  RUN_TEST(test_linear_default);
+  RUN_TEST(test_interpolation_between_the_points);
+  RUN_TEST(test_extrapolation_of_the_outer_segments);
+  RUN_TEST(test_rounding_to_the_nearest_cm);
+  RUN_TEST(test_table_survives_a_reset);
+  RUN_TEST(test_single_point_isnt_used);
+  RUN_TEST(test_points_have_to_ascend);
+  RUN_TEST(test_table_is_limited);
+  return UNITY_END();
+}
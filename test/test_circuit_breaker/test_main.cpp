@@ -0,0 +1,94 @@
+#include <unity.h>
+#include "CircuitBreaker.h"
+
+typedef CircuitBreaker<3, 1000, 8000> Breaker;
+
+void setUp(void) {
+  mockMillis() = 0;
+}
+
+void tearDown(void) {
+}
+
+/**
+ * Lets the given breaker fail until it opens.
+ * @param breaker Given breaker
+ */
+static void openBreaker(Breaker &breaker) {
+  for (uint8_t i = 0; i < 3; i++) {
+    breaker.failed();
+  }
+}
+
+void test_opens_after_the_threshold(void) {
+  Breaker breaker;
+  breaker.failed();
+  breaker.failed();
+  TEST_ASSERT_TRUE(breaker.allow());
+  breaker.failed();
+  TEST_ASSERT_EQUAL(BREAKER_OPEN, breaker.state());
+  TEST_ASSERT_FALSE(breaker.allow());
+}
+
+void test_success_resets_the_failures(void) {
+  Breaker breaker;
+  breaker.failed();
+  breaker.failed();
+  breaker.succeeded();
+  breaker.failed();
+  breaker.failed();
+  TEST_ASSERT_EQUAL(BREAKER_CLOSED, breaker.state());
+}
+
+void test_trial_after_the_backoff(void) {
+  Breaker breaker;
+  openBreaker(breaker);
+  mockMillis() = 999;
+  TEST_ASSERT_FALSE(breaker.allow());
+  mockMillis() = 1000;
+  TEST_ASSERT_TRUE(breaker.allow());
+  TEST_ASSERT_EQUAL(BREAKER_HALF_OPEN, breaker.state());
+  breaker.succeeded();
+  TEST_ASSERT_EQUAL(BREAKER_CLOSED, breaker.state());
+}
+
+void test_failed_trial_doubles_the_backoff(void) {
+  Breaker breaker;
+  openBreaker(breaker);
+  unsigned long expected[] = { 2000, 4000, 8000, 8000 };
+  for (uint8_t i = 0; i < 4; i++) {
+    while (!breaker.allow()) {
+      mockMillis() += 100;
+    }
+    breaker.failed();
+    unsigned long openedAt = mockMillis();
+    mockMillis() = openedAt + expected[i] - 1;
+    TEST_ASSERT_FALSE(breaker.allow());
+    mockMillis() = openedAt + expected[i];
+    TEST_ASSERT_TRUE(breaker.allow());
+  }
+}
+
+void test_success_resets_the_backoff(void) {
+  Breaker breaker;
+  openBreaker(breaker);
+  mockMillis() = 1000;
+  breaker.allow();
+  breaker.failed();
+  mockMillis() = 3000;
+  breaker.allow();
+  breaker.succeeded();
+  openBreaker(breaker);
+  mockMillis() = 4000;
+  TEST_ASSERT_TRUE(breaker.allow());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_opens_after_the_threshold);
+  RUN_TEST(test_success_resets_the_failures);
+  RUN_TEST(test_trial_after_the_backoff);
+  RUN_TEST(test_failed_trial_doubles_the_backoff);
+  RUN_TEST(test_success_resets_the_backoff);
+  return UNITY_END();
+}
@@ -0,0 +1,61 @@
+#include <unity.h>
+#include "WaterSensor.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_echo_in_mm(void) {
+  TEST_ASSERT_EQUAL_INT(10, echoToDistance(US_PER_CM));
+  TEST_ASSERT_EQUAL_INT(1000, echoToDistance(100L * US_PER_CM));
+  TEST_ASSERT_EQUAL_INT(4000, echoToDistance(400L * US_PER_CM));
+}
+
+void test_echo_below_one_cm(void) {
+
+  // The 4 us steps of micros() are below 1 mm
+  TEST_ASSERT_EQUAL_INT(0, echoToDistance(2));
+  TEST_ASSERT_EQUAL_INT(1, echoToDistance(4));
+  TEST_ASSERT_EQUAL_INT(5, echoToDistance(29));
+  TEST_ASSERT_EQUAL_INT(1235, echoToDistance(7164));
+}
+
+void test_pressure_in_mm(void) {
+  PressureSensor sensor(A0, 102, 922, 500, 450);
+  mockAnalog(A0) = 102;
+  TEST_ASSERT_TRUE(sensor.sample());
+  TEST_ASSERT_EQUAL_INT(4500, sensor.distance());
+  mockAnalog(A0) = 512;
+  TEST_ASSERT_TRUE(sensor.sample());
+  TEST_ASSERT_EQUAL_INT(2000, sensor.distance());
+}
+
+void test_pressure_out_of_span(void) {
+  PressureSensor sensor(A0, 102, 922, 500, 450);
+  mockAnalog(A0) = 50;
+  TEST_ASSERT_FALSE(sensor.sample());
+  TEST_ASSERT_EQUAL_UINT8(HEALTH_MAX - HEALTH_LOSS, sensor.health());
+}
+
+void test_fusion_keeps_the_mm(void) {
+  PressureSensor first(A0, 0, 1000, 1000, 500);
+  PressureSensor second(A1, 0, 1000, 1000, 500);
+  WaterSensor *sensors[] = { &first, &second, NULL };
+  mockAnalog(A0) = 100;
+  mockAnalog(A1) = 101;
+  first.sample();
+  second.sample();
+  TEST_ASSERT_EQUAL_INT(3995, fuseSensors(sensors, 3));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_echo_in_mm);
+  RUN_TEST(test_echo_below_one_cm);
+  RUN_TEST(test_pressure_in_mm);
+  RUN_TEST(test_pressure_out_of_span);
+  RUN_TEST(test_fusion_keeps_the_mm);
+  return UNITY_END();
+}
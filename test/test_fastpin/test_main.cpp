@@ -0,0 +1,58 @@
+#include <unity.h>
+#include "FastPin.h"
+
+void setUp(void) {
+  memset((void *) mockRegisters(), 0, 9);
+}
+
+void tearDown(void) {
+}
+
+void test_port_of_every_pin(void) {
+  for (uint8_t pin = 0; pin < 8; pin++) {
+    TEST_ASSERT_EQUAL_UINT8(0, fastPinPort(pin));
+    TEST_ASSERT_EQUAL_UINT8(pin, fastPinBit(pin));
+  }
+  for (uint8_t pin = 8; pin < 14; pin++) {
+    TEST_ASSERT_EQUAL_UINT8(1, fastPinPort(pin));
+    TEST_ASSERT_EQUAL_UINT8(pin - 8, fastPinBit(pin));
+  }
+  for (uint8_t pin = A0; pin <= A5; pin++) {
+    TEST_ASSERT_EQUAL_UINT8(2, fastPinPort(pin));
+    TEST_ASSERT_EQUAL_UINT8(pin - A0, fastPinBit(pin));
+  }
+}
+
+void test_output_drives_its_bit_only(void) {
+  FastPin<13>::output();
+  FastPin<13>::high();
+  TEST_ASSERT_EQUAL_HEX8(0x20, DDRB);
+  TEST_ASSERT_EQUAL_HEX8(0x20, PORTB);
+  TEST_ASSERT_EQUAL_HEX8(0x00, PORTD);
+  FastPin<13>::low();
+  TEST_ASSERT_EQUAL_HEX8(0x00, PORTB);
+}
+
+void test_input_drops_the_pull_up(void) {
+  DDRD = 0xFF;
+  PORTD = 0xFF;
+  FastPin<7>::input();
+  TEST_ASSERT_EQUAL_HEX8(0x7F, DDRD);
+  TEST_ASSERT_EQUAL_HEX8(0x7F, PORTD);
+}
+
+void test_read_of_the_input_register(void) {
+  PINC = 0x01;
+  TEST_ASSERT_TRUE(FastPin<A0>::read());
+  TEST_ASSERT_FALSE(FastPin<A1>::read());
+  TEST_ASSERT_FALSE(FastPin<8>::read());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_port_of_every_pin);
+  RUN_TEST(test_output_drives_its_bit_only);
+  RUN_TEST(test_input_drops_the_pull_up);
+  RUN_TEST(test_read_of_the_input_register);
+  return UNITY_END();
+}
@@ -0,0 +1,151 @@
+#include <unity.h>
+#include <new>
+#include "MockSerial.h"
+#include "Sim800Modem.h"
+
+// Time in ms which passes between two polls of a flow
+#define POLL_STEP 10
+
+// Highest number of polls of a flow before the test gives up
+#define MAX_POLLS 10000
+
+// Polls the given flow of the modem until it ended
+#define RUN_FLOW(flow) \
+  do { \
+    PT_INIT(&pt); \
+    for (uint16_t i = 0; i < MAX_POLLS && (flow) == PT_WAITING; i++) { \
+      mockMillis() += POLL_STEP; \
+    } \
+  } while (0)
+
+MockSerial serial;
+Sim800Modem *modem;
+Pt pt;
+
+/**
+ * Writes a short text as body of a request or a sms.
+ * @param out Given output
+ */
+static void writeHello(Print &out) {
+  out.print(F("hello"));
+}
+
+void setUp(void) {
+  static uint8_t memory[sizeof(Sim800Modem)];
+  serial.clear();
+  mockMillis() = 0;
+
+  // Every test starts with a module without statistics
+  modem = new (memory) Sim800Modem(serial, F("internet"), F("user"), F("pw"));
+}
+
+void tearDown(void) {
+}
+
+void test_sms_accepted(void) {
+  serial.answer("AT+CMGS=\"+4915112345678\"", "\r\n> ");
+  serial.answer("hello\x1A", "\r\n+CMGS: 42\r\n\r\nOK\r\n");
+  RUN_FLOW(modem->sendSms(&pt, "+4915112345678", writeHello));
+  TEST_ASSERT_TRUE(serial.done());
+  TEST_ASSERT_TRUE(modem->result());
+  TEST_ASSERT_EQUAL_UINT8(42, modem->smsReference());
+}
+
+void test_sms_refused_leaves_the_input_mode(void) {
+  serial.answer("AT+CMGS=", "\r\nERROR\r\n");
+  RUN_FLOW(modem->sendSms(&pt, "+4915112345678", writeHello));
+  TEST_ASSERT_FALSE(modem->result());
+  TEST_ASSERT_TRUE(strchr(serial.sent(), 27) != NULL);
+  TEST_ASSERT_TRUE(strstr(serial.sent(), "hello") == NULL);
+  TEST_ASSERT_EQUAL_UINT16(1, modem->stats(AT_STEP_SMS).errors);
+}
+
+void test_silent_module_times_out(void) {
+  RUN_FLOW(modem->sendSms(&pt, "+4915112345678", writeHello));
+  TEST_ASSERT_FALSE(modem->result());
+  TEST_ASSERT_TRUE(mockMillis() >= AT_TIMEOUT);
+  TEST_ASSERT_TRUE(mockMillis() < AT_TIMEOUT + 2 * POLL_STEP);
+  TEST_ASSERT_EQUAL_UINT16(1, modem->stats(AT_STEP_SMS).timeouts);
+}
+
+void test_status_report_is_taken_out(void) {
+  serial.answer("AT+CMGS=", "\r\n+CDS: 6,42,\"+4915112345678\",145,"
+      "\"26/10/17,10:00:00+08\",\"26/10/17,10:00:05+08\",0\r\n\r\n> ");
+  serial.answer("hello", "\r\n+CMGS: 43\r\n");
+  RUN_FLOW(modem->sendSms(&pt, "+4915112345678", writeHello));
+  TEST_ASSERT_TRUE(modem->result());
+  StatusReport report;
+  TEST_ASSERT_TRUE(modem->nextStatusReport(report));
+  TEST_ASSERT_EQUAL_UINT8(42, report.reference);
+  TEST_ASSERT_EQUAL_UINT8(0, report.status);
+}
+
+void test_connect(void) {
+  serial.answer("AT+SAPBR=3,1", "\r\nOK\r\n");
+  serial.answer("AT+SAPBR=1,1", "\r\nOK\r\n");
+  serial.answer("AT+SAPBR=2,1;+HTTPINIT", "\r\n+SAPBR: 1,1,\"10.0.0.1\"\r\n"
+      "\r\nOK\r\n");
+  RUN_FLOW(modem->connect(&pt));
+  TEST_ASSERT_TRUE(serial.done());
+  TEST_ASSERT_TRUE(modem->result());
+  TEST_ASSERT_TRUE(strstr(serial.sent(),
+      "+CSTT=\"internet\",\"user\",\"pw\"\r\n") != NULL);
+}
+
+void test_connect_without_bearer(void) {
+  serial.answer("AT+SAPBR=3,1", "\r\nOK\r\n");
+  serial.answer("AT+SAPBR=1,1", "\r\nERROR\r\n");
+  RUN_FLOW(modem->connect(&pt));
+  TEST_ASSERT_FALSE(modem->result());
+  TEST_ASSERT_TRUE(strstr(serial.sent(), "HTTPINIT") == NULL);
+  TEST_ASSERT_EQUAL_UINT16(1, modem->stats(AT_STEP_BEARER).errors);
+}
+
+void test_http_post(void) {
+
+  // The body follows DOWNLOAD without a line ending, its OK is queued
+  serial.answer("AT+HTTPDATA=5,10000", "\r\nDOWNLOAD\r\n\r\nOK\r\n");
+  serial.answer("AT+HTTPACTION=1", "\r\nOK\r\n\r\n+HTTPACTION: 1,201,3\r\n");
+  RUN_FLOW(modem->httpPost(&pt, writeHello));
+  TEST_ASSERT_TRUE(serial.done());
+  TEST_ASSERT_EQUAL_INT(201, modem->result());
+  TEST_ASSERT_EQUAL_UINT16(3, modem->responseLength());
+  TEST_ASSERT_TRUE(strstr(serial.sent(), "hello") != NULL);
+}
+
+void test_http_post_network_error(void) {
+  serial.answer("AT+HTTPDATA=", "\r\nDOWNLOAD\r\n\r\nOK\r\n");
+  serial.answer("AT+HTTPACTION=1", "\r\nOK\r\n\r\n+HTTPACTION: 1,601,0\r\n");
+  RUN_FLOW(modem->httpPost(&pt, writeHello));
+  TEST_ASSERT_EQUAL_INT(601, modem->result());
+  TEST_ASSERT_EQUAL_UINT16(0, modem->responseLength());
+}
+
+void test_http_post_refused_data(void) {
+  serial.answer("AT+HTTPDATA=", "\r\nERROR\r\n");
+  RUN_FLOW(modem->httpPost(&pt, writeHello));
+  TEST_ASSERT_EQUAL_INT(0, modem->result());
+  TEST_ASSERT_TRUE(strstr(serial.sent(), "HTTPACTION") == NULL);
+}
+
+void test_udp_datagram_truncated(void) {
+  uint8_t buffer[4];
+  serial.unsolicited("\r\n+IPD,6:abcdef");
+  TEST_ASSERT_EQUAL_INT(6, modem->udpRead(buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_MEMORY("abcd", buffer, sizeof(buffer));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sms_accepted);
+  RUN_TEST(test_sms_refused_leaves_the_input_mode);
+  RUN_TEST(test_silent_module_times_out);
+  RUN_TEST(test_status_report_is_taken_out);
+  RUN_TEST(test_connect);
+  RUN_TEST(test_connect_without_bearer);
+  RUN_TEST(test_http_post);
+  RUN_TEST(test_http_post_network_error);
+  RUN_TEST(test_http_post_refused_data);
+  RUN_TEST(test_udp_datagram_truncated);
+  return UNITY_END();
+}
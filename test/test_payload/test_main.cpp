@@ -0,0 +1,83 @@
+#include <unity.h>
+#include "Payload.h"
+
+/**
+ * Output which collects the written bytes.
+ */
+class ArrayPrint : public Print {
+public:
+  ArrayPrint() : length(0) {
+  }
+
+  size_t write(uint8_t c) {
+    data[length++] = c;
+    return 1;
+  }
+
+  using Print::write;
+
+  uint8_t data[64];
+  uint8_t length;
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_batch_header(void) {
+  ArrayPrint out;
+  writeBatchHeader(out, 0x1234, 0xFFFE, 16);
+  const uint8_t expected[] = { PAYLOAD_VERSION, 0x12, 0x34, 0xFF, 0xFE, 16 };
+  TEST_ASSERT_EQUAL_UINT8(BATCH_HEADER_SIZE, out.length);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out.data, BATCH_HEADER_SIZE);
+}
+
+void test_reading_big_endian(void) {
+  Reading reading;
+  reading.time = 0x5F5E1001UL;
+  reading.level = -12;
+  reading.vcc = 4950;
+  reading.vmin = 4800;
+  reading.vmax = 5010;
+  reading.temperature = -3;
+  reading.diagnostics = DIAG_ALERT_SLO;
+  reading.alertP50 = 0x0102;
+  reading.alertP95 = 0x0A0B;
+  ArrayPrint out;
+  writeReading(out, reading);
+  const uint8_t expected[] = {
+    0x5F, 0x5E, 0x10, 0x01, 0xFF, 0xF4, 0x13, 0x56, 0x12, 0xC0, 0x13, 0x92,
+    0xFD, 0x01, 0x01, 0x02, 0x0A, 0x0B
+  };
+  TEST_ASSERT_EQUAL_UINT8(READING_SIZE, out.length);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out.data, READING_SIZE);
+}
+
+void test_delivery_stats_with_their_count(void) {
+  DeliveryStats stats[2] = { { 3, 1, 0, 0x0123 }, { 0, 0, 2, 0 } };
+  ArrayPrint out;
+  writeDeliveryStats(out, stats, 2);
+  const uint8_t expected[] = { 2, 3, 1, 0, 0x01, 0x23, 0, 0, 2, 0, 0 };
+  TEST_ASSERT_EQUAL_UINT8(1 + 2 * DELIVERY_STATS_SIZE, out.length);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out.data, sizeof(expected));
+}
+
+void test_link_stats(void) {
+  LinkStats stats = { 0xABCD, 300 };
+  ArrayPrint out;
+  writeLinkStats(out, stats);
+  const uint8_t expected[] = { 0xAB, 0xCD, 0x01, 0x2C };
+  TEST_ASSERT_EQUAL_UINT8(LINK_STATS_SIZE, out.length);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out.data, LINK_STATS_SIZE);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_batch_header);
+  RUN_TEST(test_reading_big_endian);
+  RUN_TEST(test_delivery_stats_with_their_count);
+  RUN_TEST(test_link_stats);
+  return UNITY_END();
+}
@@ -0,0 +1,124 @@
+#include <unity.h>
+#include <stdio.h>
+#include "MockSerial.h"
+#include "Sim800Modem.h"
+
+// Size of the data which is split into three parts
+#define DATA_SIZE 300
+
+// Highest number of polls of a flow before the test gives up
+#define MAX_POLLS 1000
+
+MockSerial serial;
+Sim800Modem modem(serial, F("internet"), F(""), F(""));
+Pt pt;
+
+/**
+ * Writes the bytes 0, 1, 2, ... as data of the sms.
+ * @param out Given output
+ */
+static void writeData(Print &out) {
+  for (uint16_t i = 0; i < DATA_SIZE; i++) {
+    out.write((uint8_t) i);
+  }
+}
+
+/**
+ * Sends one part of the data with the script of the module.
+ * @param  part   Given index of the part
+ * @param  length Given TPDU length the module has to be told
+ * @param  pdu    Given start of the PDU the module has to receive
+ * @return Returns true if the flow ended with the part accepted.
+ */
+static boolean sendPart(uint8_t part, const char *length, const char *pdu) {
+  serial.clear();
+  serial.answer("AT+CMGF=0", "\r\nOK\r\n");
+  serial.answer(length, "\r\n> ");
+  serial.answer(pdu, "\r\n+CMGS: 42\r\n\r\nOK\r\n");
+  serial.answer("AT+CMGF=1", "\r\nOK\r\n");
+  PT_INIT(&pt);
+  for (uint16_t i = 0; i < MAX_POLLS; i++) {
+    if (modem.sendDataSms(&pt, F("+4915112345678"), writeData, 7, part)
+        == PT_ENDED) {
+      return serial.done() && modem.result();
+    }
+  }
+  return false;
+}
+
+/**
+ * Builds the hex digits of a window of the data.
+ * @param hex    Built digits
+ * @param offset Given offset of the window
+ * @param length Given length of the window
+ */
+static void dataHex(char *hex, uint16_t offset, uint8_t length) {
+  for (uint8_t i = 0; i < length; i++) {
+    sprintf(hex + 2 * i, "%02X", (uint8_t) (offset + i));
+  }
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_first_part(void) {
+  char expected[512] = "00" "51000D91945111325476F8" "0004A7" "8C"
+      "050003070301";
+  dataHex(expected + strlen(expected), 0, SMS_PART_SIZE);
+  TEST_ASSERT_TRUE(sendPart(0, "AT+CMGS=155", expected));
+  TEST_ASSERT_TRUE(strstr(serial.sent(), expected) != NULL);
+}
+
+void test_last_part_is_shorter(void) {
+  char expected[512] = "00" "51000D91945111325476F8" "0004A7" "26"
+      "050003070303";
+  dataHex(expected + strlen(expected), 2 * SMS_PART_SIZE,
+      DATA_SIZE - 2 * SMS_PART_SIZE);
+  strcat(expected, "\x1A");
+  TEST_ASSERT_TRUE(sendPart(2, "AT+CMGS=53", expected));
+}
+
+void test_national_number(void) {
+  serial.clear();
+  serial.answer("AT+CMGF=0", "\r\nOK\r\n");
+  serial.answer("AT+CMGS=", "\r\n> ");
+  serial.answer("00" "51000B81" "1015325476F7", "\r\n+CMGS: 1\r\n");
+  serial.answer("AT+CMGF=1", "\r\nOK\r\n");
+  PT_INIT(&pt);
+  for (uint16_t i = 0; i < MAX_POLLS; i++) {
+    if (modem.sendDataSms(&pt, F("01512345677"), writeData, 1, 0)
+        == PT_ENDED) {
+      break;
+    }
+  }
+  TEST_ASSERT_TRUE(serial.done());
+  TEST_ASSERT_TRUE(modem.result());
+}
+
+void test_refused_prompt_leaves_the_input_mode(void) {
+  serial.clear();
+  serial.answer("AT+CMGF=0", "\r\nOK\r\n");
+  serial.answer("AT+CMGS=", "\r\nERROR\r\n");
+  serial.answer("\x1B" "AT+CMGF=1", "\r\nOK\r\n");
+  PT_INIT(&pt);
+  for (uint16_t i = 0; i < MAX_POLLS; i++) {
+    if (modem.sendDataSms(&pt, F("+4915112345678"), writeData, 7, 0)
+        == PT_ENDED) {
+      break;
+    }
+  }
+  TEST_ASSERT_TRUE(serial.done());
+  TEST_ASSERT_FALSE(modem.result());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_part);
+  RUN_TEST(test_last_part_is_shorter);
+  RUN_TEST(test_national_number);
+  RUN_TEST(test_refused_prompt_leaves_the_input_mode);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+#include <unity.h>
+#include "EEPROM.h"
+#include "ReadingLog.h"
+
+/**
+ * Output which keeps the time of the first written reading.
+ */
+class FirstReadingPrint : public Print {
+public:
+  FirstReadingPrint() : length(0), time(0) {
+  }
+
+  size_t write(uint8_t c) {
+    if (length < 4) {
+      time = time << 8 | c;
+    }
+    length++;
+    return 1;
+  }
+
+  using Print::write;
+
+  uint16_t length;
+  uint32_t time;
+};
+
+/**
+ * Appends readings whose times count up from the given one.
+ * @param log   Given log
+ * @param first Given time of the first reading
+ * @param count Given number of readings
+ */
+static void appendReadings(ReadingLog &log, uint32_t first, uint32_t count) {
+  Reading reading;
+  memset(&reading, 0, sizeof(reading));
+  for (uint32_t i = 0; i < count; i++) {
+    reading.time = first + i;
+    log.append(reading);
+  }
+}
+
+void setUp(void) {
+  EEPROM.clear();
+}
+
+void tearDown(void) {
+}
+
+void test_empty_log(void) {
+  ReadingLog log;
+  log.recover();
+  TEST_ASSERT_EQUAL_UINT8(0, log.pending());
+  TEST_ASSERT_EQUAL_UINT16(0, log.firstSequence());
+}
+
+void test_recover_of_the_pending_readings(void) {
+  ReadingLog log;
+  appendReadings(log, 0, 12);
+  log.acknowledge(5);
+  ReadingLog recovered;
+  recovered.recover();
+  TEST_ASSERT_EQUAL_UINT8(7, recovered.pending());
+  TEST_ASSERT_EQUAL_UINT16(5, recovered.firstSequence());
+}
+
+void test_recover_after_the_ring_wrapped(void) {
+  ReadingLog log;
+  appendReadings(log, 0, LOG_SLOTS + 10);
+  TEST_ASSERT_EQUAL_UINT8(LOG_SLOTS, log.pending());
+  ReadingLog recovered;
+  recovered.recover();
+  TEST_ASSERT_EQUAL_UINT8(LOG_SLOTS, recovered.pending());
+  TEST_ASSERT_EQUAL_UINT16(10, recovered.firstSequence());
+  FirstReadingPrint out;
+  recovered.write(out, 1);
+  TEST_ASSERT_EQUAL_UINT32(10, out.time);
+}
+
+void test_recover_after_the_sequence_wrapped(void) {
+  ReadingLog log;
+  appendReadings(log, 0, 0x10000UL + 10);
+  ReadingLog recovered;
+  recovered.recover();
+  TEST_ASSERT_EQUAL_UINT8(LOG_SLOTS, recovered.pending());
+  TEST_ASSERT_EQUAL_UINT16((uint16_t) (10 - LOG_SLOTS),
+      recovered.firstSequence());
+  FirstReadingPrint out;
+  recovered.write(out, 1);
+  TEST_ASSERT_EQUAL_UINT32(0x10000UL + 10 - LOG_SLOTS, out.time);
+  recovered.write(out, LOG_SLOTS);
+  TEST_ASSERT_EQUAL_UINT16((LOG_SLOTS + 1) * READING_SIZE, out.length);
+}
+
+void test_torn_record_is_dropped(void) {
+  ReadingLog log;
+  appendReadings(log, 0, 8);
+
+  // The reset hit the write of the newest record before its checksum
+  int address = LOG_ADDR + 7 * sizeof(LogRecord)
+      + offsetof(LogRecord, checksum);
+  EEPROM.write(address, EEPROM.read(address) ^ 0xFF);
+  ReadingLog recovered;
+  recovered.recover();
+  TEST_ASSERT_EQUAL_UINT8(7, recovered.pending());
+  TEST_ASSERT_EQUAL_UINT16(0, recovered.firstSequence());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_log);
+  RUN_TEST(test_recover_of_the_pending_readings);
+  RUN_TEST(test_recover_after_the_ring_wrapped);
+  RUN_TEST(test_recover_after_the_sequence_wrapped);
+  RUN_TEST(test_torn_record_is_dropped);
+  return UNITY_END();
+}
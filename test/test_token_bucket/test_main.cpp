@@ -0,0 +1,69 @@
+#include <unity.h>
+#include "TokenBucket.h"
+
+void setUp(void) {
+  mockMillis() = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_burst_up_to_the_capacity(void) {
+  TokenBucket<3, 1000> bucket;
+  TEST_ASSERT_TRUE(bucket.take());
+  TEST_ASSERT_TRUE(bucket.take());
+  TEST_ASSERT_TRUE(bucket.take());
+  TEST_ASSERT_FALSE(bucket.take());
+}
+
+void test_one_token_per_refill(void) {
+  TokenBucket<3, 1000> bucket;
+  for (uint8_t i = 0; i < 3; i++) {
+    bucket.take();
+  }
+  mockMillis() = 999;
+  TEST_ASSERT_FALSE(bucket.take());
+  mockMillis() = 1000;
+  TEST_ASSERT_TRUE(bucket.take());
+  TEST_ASSERT_FALSE(bucket.take());
+  mockMillis() = 2500;
+  TEST_ASSERT_TRUE(bucket.take());
+  TEST_ASSERT_FALSE(bucket.take());
+}
+
+void test_refill_stops_at_the_capacity(void) {
+  TokenBucket<3, 1000> bucket;
+  bucket.take();
+  mockMillis() = 100000;
+  for (uint8_t i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(bucket.take());
+  }
+  TEST_ASSERT_FALSE(bucket.take());
+}
+
+void test_available_keeps_the_token(void) {
+  TokenBucket<1, 1000> bucket;
+  TEST_ASSERT_TRUE(bucket.available());
+  TEST_ASSERT_TRUE(bucket.available());
+  TEST_ASSERT_TRUE(bucket.take());
+  TEST_ASSERT_FALSE(bucket.available());
+}
+
+void test_refill_across_the_overflow_of_millis(void) {
+  mockMillis() = 0xFFFFFC00UL;
+  TokenBucket<1, 1000> bucket;
+  bucket.available();
+  TEST_ASSERT_TRUE(bucket.take());
+  mockMillis() = 0xFFFFFC00UL + 1000;
+  TEST_ASSERT_TRUE(bucket.take());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_up_to_the_capacity);
+  RUN_TEST(test_one_token_per_refill);
+  RUN_TEST(test_refill_stops_at_the_capacity);
+  RUN_TEST(test_available_keeps_the_token);
+  RUN_TEST(test_refill_across_the_overflow_of_millis);
+  return UNITY_END();
+}
@@ -0,0 +1,64 @@
+#include <unity.h>
+#include "EEPROM.h"
+#include "UploadSlot.h"
+
+void setUp(void) {
+  EEPROM.clear();
+}
+
+void tearDown(void) {
+}
+
+void test_parse_of_the_response(void) {
+  TEST_ASSERT_EQUAL_UINT16(317, parseSlotOffset("317"));
+  TEST_ASSERT_EQUAL_UINT16(0, parseSlotOffset("0"));
+  TEST_ASSERT_EQUAL_UINT16(SLOT_MAX, parseSlotOffset("3599"));
+}
+
+void test_parse_rejects_other_responses(void) {
+  TEST_ASSERT_EQUAL_UINT16(NO_SLOT, parseSlotOffset(""));
+  TEST_ASSERT_EQUAL_UINT16(NO_SLOT, parseSlotOffset("3600"));
+  TEST_ASSERT_EQUAL_UINT16(NO_SLOT, parseSlotOffset("12a"));
+  TEST_ASSERT_EQUAL_UINT16(NO_SLOT, parseSlotOffset("-5"));
+  TEST_ASSERT_EQUAL_UINT16(NO_SLOT, parseSlotOffset("99999999"));
+}
+
+void test_offset_assigned_by_the_server(void) {
+  TEST_ASSERT_EQUAL_UINT16(317, slotOffset(1, 317, 3600));
+  TEST_ASSERT_EQUAL_UINT16(100, slotOffset(1, 1000, 900));
+}
+
+void test_offset_spread_by_the_id(void) {
+  TEST_ASSERT_EQUAL_UINT16(2224, slotOffset(1, NO_SLOT, 3600));
+  TEST_ASSERT_EQUAL_UINT16(849, slotOffset(2, NO_SLOT, 3600));
+  for (uint16_t id = 1; id < 200; id++) {
+    TEST_ASSERT_TRUE(slotOffset(id, NO_SLOT, 900) < 900);
+    TEST_ASSERT_TRUE(slotOffset(id, NO_SLOT, 900)
+        != slotOffset(id + 1, NO_SLOT, 900));
+  }
+}
+
+void test_assignment_in_the_eeprom(void) {
+  TEST_ASSERT_EQUAL_UINT16(NO_SLOT, loadSlotOffset());
+  TEST_ASSERT_TRUE(saveSlotOffset(317));
+  TEST_ASSERT_EQUAL_UINT16(317, loadSlotOffset());
+  TEST_ASSERT_FALSE(saveSlotOffset(SLOT_MAX + 1));
+  TEST_ASSERT_EQUAL_UINT16(317, loadSlotOffset());
+}
+
+void test_broken_assignment_is_dropped(void) {
+  saveSlotOffset(317);
+  EEPROM.write(SLOT_ADDR, EEPROM.read(SLOT_ADDR) ^ 0x01);
+  TEST_ASSERT_EQUAL_UINT16(NO_SLOT, loadSlotOffset());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_of_the_response);
+  RUN_TEST(test_parse_rejects_other_responses);
+  RUN_TEST(test_offset_assigned_by_the_server);
+  RUN_TEST(test_offset_spread_by_the_id);
+  RUN_TEST(test_assignment_in_the_eeprom);
+  RUN_TEST(test_broken_assignment_is_dropped);
+  return UNITY_END();
+}